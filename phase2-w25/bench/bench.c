@@ -0,0 +1,726 @@
+/* bench.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../include/source.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/semantic.h"
+#include "../include/ast_cache.h"
+#include "corpus.h"
+
+/* Frontend throughput benchmarks
+ * Every shape is generated at `steps` sizes, doubling from `units`, and each phase is timed on it:
+ * get_next_token (MB/s and tokens/s), parse, parse_iterative and parse_parallel (nodes/s, one thread per core
+ * unless --threads says otherwise), lex_edit and parse_edit (microseconds to type a character somewhere in the
+ * source), the tree left by hash-consing (percent of the nodes), ast_cache_load of a saved tree (nodes/s, so it
+ * reads against the parse columns) and analyze_semantics (symbols/s). A phase is flagged when its time grows
+ * faster than its work across the sizes, which a linear frontend never does. An edit moves the source bytes,
+ * tokens and node token indices after it, so its time is held against the source size.
+ * Semantic work is counted in nodes, some shapes declare the same few symbols at every size.
+ * The parse columns also list the AST memory per node and the allocations of the first parse, later
+ * runs reuse the node arrays and any allocation they make is flagged.
+ * Before timing, lex_parallel is checked against lex_all on a generated program, once as is and once with a NUL
+ * byte in the middle, and parse_iterative and parse_parallel (2, 4 and 8 threads) against parse on every shape and
+ * on random programs with syntax errors, and lex_edit and parse_edit against a fresh lex_all and parse after random
+ * edits of random programs. analyze_semantics must also give the same verdict and messages with hash-consing on.
+ * The benchmark fails when they differ.
+ *
+ * Build from phase2-w25:
+ *   gcc -std=gnu11 -O2 bench/bench.c bench/corpus.c $(find src -name '*.c' ! -name main.c) -o seaplus_bench -lpthread -lm
+ * Run:
+ *   ./seaplus_bench [--shape NAME|all] [--units N] [--steps K] [--depth D] [--threads T] [--dump FILE] */
+
+#define MIN_SECONDS 0.2         // Keep repeating a measurement until it has run this long
+#define MAX_RUNS 5
+#define MAX_STEPS 16
+#define EDITS 64                // Characters typed and deleted again by the edit measurement
+#define SUPERLINEAR_EXPONENT 1.5   // Quadratic work shows up as 2, cache effects stay well below
+// The recursive parser and the checker recurse once per nesting level, deep --depth values still need room
+#define BENCH_STACK ((size_t)512 << 20)
+
+typedef struct {
+    int shape;                  // -1 for every shape
+    size_t units;
+    int steps;
+    int depth;
+    int threads;                // parse_parallel threads, 0 for one per core
+    const char* dump;
+} BenchOptions;
+
+typedef struct {
+    size_t units;
+    size_t bytes;
+    size_t tokens;
+    size_t nodes;
+    size_t symbols;
+    size_t ast_bytes;           // Node arrays of the parse
+    size_t mallocs;             // Node array allocations of the first parse
+    size_t steady_mallocs;      // Node array allocations of every later parse together, 0 when reuse works
+    size_t cons_nodes;          // Nodes of the parse with hash-consing
+    double lex;                 // Best time of each phase in seconds
+    double parse;
+    double parse_iterative;
+    double parse_parallel;
+    double edit;                // Mean time of one edit
+    double cache_load;          // INFINITY when the cache could not be written
+    double semantic;
+} BenchRow;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Keeps anything a phase prints out of the results, the analyzer itself reports into a DiagSink
+static int quiet_begin(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+    return saved;
+}
+
+static void quiet_end(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+// Every node of a parse is part of its tree, so nodes and declarations are counted straight off the arrays
+static size_t count_symbols(const Ast* ast) {
+    size_t symbols = 0;
+    for (NodeId node = 1; node < ast->count; node++) {
+        ASTNodeType kind = ast_kind(ast, node);
+        symbols += kind == AST_INT || (kind == AST_STRINGCHAR && ast_token(ast, node).type == TOKEN_IDENTIFIER);
+    }
+    return symbols;
+}
+
+/* --- PHASES --- */
+static double time_lex(const Source* source, size_t* tokens) {
+    double best = INFINITY, total = 0;
+    for (int run = 0; run < MAX_RUNS && total < MIN_SECONDS; run++) {
+        LexerState lexer;
+        lexer_init(&lexer, source);
+        size_t count = 0;
+        double start = now();
+        while (get_next_token(&lexer).type != TOKEN_EOF) count++;
+        double elapsed = now() - start;
+        *tokens = count + 1;
+        total += elapsed;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static int parse_threads = 1;
+
+static NodeId parse_on_every_core(ParserState* parser) {
+    return parse_parallel(parser, parse_threads);
+}
+
+static double time_parse(TokenBuffer* tokens, NodeId (*parse_function)(ParserState*), BenchRow* row) {
+    double best = INFINITY, total = 0;
+    ParserState parser;
+    parser_init(&parser, tokens);
+    for (int run = 0; run < MAX_RUNS && total < MIN_SECONDS; run++) {
+        parser_reset(&parser);
+        size_t mallocs = parser.ast.allocations;
+        int saved = quiet_begin();
+        double start = now();
+        parse_function(&parser);
+        double elapsed = now() - start;
+        quiet_end(saved);
+        if (run == 0) {
+            row->nodes = parser.ast.count - 1;
+            row->ast_bytes = ast_memory(&parser.ast);
+            row->mallocs = parser.ast.allocations;
+            row->steady_mallocs = 0;
+        } else {
+            row->steady_mallocs += parser.ast.allocations - mallocs;
+        }
+        total += elapsed;
+        if (elapsed < best) best = elapsed;
+    }
+    parser_free(&parser);
+    return best;
+}
+
+// Type a character at spread out offsets and delete it again, with lex_edit and parse_edit after each
+// Returns the mean time of an edit, or -1 when out of memory
+static double time_edit(Source* source, TokenBuffer* tokens) {
+    ParserState parser;
+    parser_init(&parser, tokens);
+    NodeId root = parse(&parser);
+    int saved = quiet_begin();
+    double start = now();
+    for (size_t i = 0; i < EDITS; i++) {
+        size_t offset = (size_t)(i * 2654435761u % (source->length + 1));
+        TokenEdit edit;
+        if (!lex_edit(tokens, source, offset, 0, "x", 1, &edit)) break;
+        root = parse_edit(&parser, root, &edit);
+        if (!lex_edit(tokens, source, offset, 1, "", 0, &edit)) break;
+        root = parse_edit(&parser, root, &edit);
+    }
+    double elapsed = now() - start;
+    quiet_end(saved);
+    parser_free(&parser);
+    return tokens->count ? elapsed / (2 * EDITS) : -1;
+}
+
+static size_t count_cons_nodes(TokenBuffer* tokens) {
+    ParserState parser;
+    parser_init(&parser, tokens);
+    parser_set_hash_consing(&parser, 1);
+    int saved = quiet_begin();
+    parse(&parser);
+    quiet_end(saved);
+    size_t nodes = parser.ast.count - 1;
+    parser_free(&parser);
+    return nodes;
+}
+
+// Save the tree to a temporary file and time loading it back, hashing the source included
+static double time_cache_load(const ParserState* parser, NodeId root) {
+    char path[] = "/tmp/seaplus_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return INFINITY;
+    close(fd);
+    double best = INFINITY, total = 0;
+    if (ast_cache_write(parser, root, path)) {
+        for (int run = 0; run < MAX_RUNS && total < MIN_SECONDS; run++) {
+            AstCache cache;
+            double start = now();
+            int loaded = ast_cache_load(&cache, parser->tokens->source, path);
+            double elapsed = now() - start;
+            if (!loaded) break;
+            ast_cache_free(&cache);
+            total += elapsed;
+            if (elapsed < best) best = elapsed;
+        }
+    }
+    unlink(path);
+    return best;
+}
+
+// Tracing is off as it is for any large input, so the analyzer only collects diagnostics
+static double time_semantic(const Ast* ast, NodeId root) {
+    double best = INFINITY, total = 0;
+    DiagSink diagnostics;
+    diag_init(&diagnostics, LOG_ERROR);
+    for (int run = 0; run < MAX_RUNS && total < MIN_SECONDS; run++) {
+        diag_clear(&diagnostics);
+        int saved = quiet_begin();
+        double start = now();
+        analyze_semantics(ast, root, &diagnostics);
+        double elapsed = now() - start;
+        quiet_end(saved);
+        total += elapsed;
+        if (elapsed < best) best = elapsed;
+    }
+    diag_free(&diagnostics);
+    return best;
+}
+
+static int bench_size(const CorpusOptions* corpus, BenchRow* row) {
+    Source source;
+    if (!corpus_generate(&source, corpus)) return 0;
+    TokenBuffer tokens;
+    if (!lex_all(&tokens, &source)) {
+        source_free(&source);
+        return 0;
+    }
+    row->units = corpus->units;
+    row->bytes = source.length;
+    row->lex = time_lex(&source, &row->tokens);
+    row->parse = time_parse(&tokens, parse, row);
+    // Same tree as parse, so the node counts of the recursive run stand for every parser
+    BenchRow other;
+    row->parse_iterative = time_parse(&tokens, parse_iterative, &other);
+    row->parse_parallel = time_parse(&tokens, parse_on_every_core, &other);
+    row->cons_nodes = count_cons_nodes(&tokens);
+
+    ParserState parser;
+    parser_init(&parser, &tokens);
+    NodeId root = parse(&parser);
+    row->symbols = count_symbols(&parser.ast);
+    row->semantic = time_semantic(&parser.ast, root);
+    row->cache_load = time_cache_load(&parser, root);
+    parser_free(&parser);
+
+    // Last, the edits move the tokens around
+    row->edit = time_edit(&source, &tokens);
+    token_buffer_free(&tokens);
+    source_free(&source);
+    return row->edit >= 0;
+}
+
+/* --- REGRESSION CHECKS --- */
+static int same_tokens(const TokenBuffer* a, const TokenBuffer* b) {
+    if (a->count != b->count) return 0;
+    for (size_t i = 0; i < a->count; i++) {
+        if (a->types[i] != b->types[i] || a->errors[i] != b->errors[i] || a->offsets[i] != b->offsets[i]
+            || a->lengths[i] != b->lengths[i] || a->atoms[i] != b->atoms[i]) return 0;
+    }
+    return 1;
+}
+
+// lex_parallel must give the tokens of lex_all, also when a NUL byte in the middle ends the input early
+// Returns 1 when every thread count agrees
+static int check_lex_parallel(void) {
+    CorpusOptions corpus = {CORPUS_FLAT, 13000, 16};   // About 600 KB, enough for 8 chunks
+    Source source;
+    if (!corpus_generate(&source, &corpus)) return 0;
+    int ok = 1;
+    for (int nul = 0; ok && nul < 2; nul++) {
+        if (nul && !source_edit(&source, source.length / 3, 1, "", 1)) {
+            ok = 0;
+            break;
+        }
+        TokenBuffer expected;
+        if (!lex_all(&expected, &source)) {
+            ok = 0;
+            break;
+        }
+        for (int threads = 2; ok && threads <= 8; threads *= 2) {
+            TokenBuffer tokens;
+            ok = lex_parallel(&tokens, &source, threads);
+            if (!ok) break;
+            if (!same_tokens(&expected, &tokens)) {
+                printf("lex_parallel with %d threads gives %zu tokens, lex_all %zu%s\n", threads, tokens.count,
+                       expected.count, nul ? " (embedded NUL)" : "");
+                ok = 0;
+            }
+            token_buffer_free(&tokens);
+        }
+        token_buffer_free(&expected);
+    }
+    source_free(&source);
+    return ok;
+}
+
+// Random programs for the parser checks. The statements parse on their own, the broken pieces do not
+static const char* check_statements[] = {
+    "int a;", "int b;", "string s;", "char c;", "a = 1;", "b = a + 2 * 3;", "a = b ^^ 2 ^^ 3;", "s = \"hi\\n\";",
+    "c = 'x';", "print(a);", "print(\"x\");", "if (a > 1) { b = a; } else { print(b); }", "while (a) { a = a - 1; break; }",
+    "repeat { print(b); } until (a == 3);", "{ int a; a = b; print(a + a); }", "a = (a + b) * (b - 1);", "x = 3;",
+    "a = $(4);", "a = b <= 3 && b != 3 || a;", "int d; d = a;", "print(d);", "s = c;", "# comment\n", "/* c */",
+};
+static const char* check_pieces[] = {
+    "if (a > 1) {", "} else {", "}", "while (a) {", "repeat {", "} until (a == 3);", "break;", "{", "int a", "a =", ";",
+    "(", ")", "\"unterminated", "5!", "|", "a = !b;", "/* open",
+};
+#define CHECK_STATEMENTS (sizeof(check_statements) / sizeof(check_statements[0]))
+#define CHECK_PIECES (sizeof(check_pieces) / sizeof(check_pieces[0]))
+#define CHECK_PROGRAMS 200          // Random programs of every check
+#define CHECK_PROGRAM_BYTES 4096
+#define CHECK_EDITS 20              // Random edits of each program
+#define PARALLEL_CHECK_TOKENS (320 * 1024)  // Enough for parse_parallel to cut 8 chunks of 32K tokens
+
+static uint64_t check_state = 88172645463325252ull;
+
+// Same sequence on every run, so a failure can be reproduced
+static uint32_t check_random(void) {
+    check_state ^= check_state << 13;
+    check_state ^= check_state >> 7;
+    check_state ^= check_state << 17;
+    return (uint32_t)check_state;
+}
+
+// Fragment for a random program or edit, one in four a broken piece when broken is set
+static const char* check_fragment(int broken) {
+    if (broken && check_random() % 4 == 0) return check_pieces[check_random() % CHECK_PIECES];
+    return check_statements[check_random() % CHECK_STATEMENTS];
+}
+
+// Up to count random fragments, separated by spaces and newlines
+static int random_program(Source* source, int count, int broken) {
+    char text[CHECK_PROGRAM_BYTES];
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        const char* fragment = check_fragment(broken);
+        size_t size = strlen(fragment);
+        if (length + size + 1 >= sizeof(text)) break;
+        memcpy(text + length, fragment, size);
+        length += size;
+        text[length++] = check_random() % 4 ? ' ' : '\n';
+    }
+    return source_from_string(source, text, length);
+}
+
+static int same_diagnostics(const ParserState* a, const ParserState* b) {
+    if (a->diagnostic_count != b->diagnostic_count) return 0;
+    for (size_t i = 0; i < a->diagnostic_count; i++) {
+        const ParseDiagnostic* x = &a->diagnostics[i];
+        const ParseDiagnostic* y = &b->diagnostics[i];
+        if (x->error != y->error || x->expected != y->expected || x->token != y->token) return 0;
+    }
+    return 1;
+}
+
+// Same nodes under the same numbers, and the same syntax errors
+static int same_arrays(const ParserState* a, const ParserState* b) {
+    const Ast* x = &a->ast;
+    const Ast* y = &b->ast;
+    if (x->count != y->count || x->child_count != y->child_count) return 0;
+    if (memcmp(x->kind, y->kind, x->count * sizeof(uint8_t)) || memcmp(x->token, y->token, x->count * sizeof(uint32_t))
+        || memcmp(x->left, y->left, x->count * sizeof(NodeId)) || memcmp(x->right, y->right, x->count * sizeof(NodeId))
+        || memcmp(x->children, y->children, x->child_count * sizeof(NodeId))) return 0;
+    return same_diagnostics(a, b);
+}
+
+// The variants must give parse's arrays and errors for tokens, what names the input in the message
+static int check_parse_variants(TokenBuffer* tokens, const char* what) {
+    ParserState expected, other;
+    parser_init(&expected, tokens);
+    parser_init(&other, tokens);
+    NodeId root = parse(&expected);
+    int ok = parse_iterative(&other) == root && same_arrays(&expected, &other);
+    if (!ok) printf("parse_iterative differs from parse on %s\n", what);
+    for (int threads = 2; ok && threads <= 8; threads *= 2) {
+        parser_reset(&other);
+        ok = parse_parallel(&other, threads) == root && same_arrays(&expected, &other);
+        if (!ok) printf("parse_parallel with %d threads differs from parse on %s\n", threads, what);
+    }
+    parser_free(&other);
+    parser_free(&expected);
+    return ok;
+}
+
+// Shape at the first size, doubling, that parse_parallel splits into 8 chunks
+static int generate_parallel_corpus(Source* source, CorpusShape shape) {
+    CorpusOptions corpus = {shape, 1000, 8};
+    while (1) {
+        if (!corpus_generate(source, &corpus)) return 0;
+        TokenBuffer tokens;
+        if (!lex_all(&tokens, source)) {
+            source_free(source);
+            return 0;
+        }
+        size_t count = tokens.count;
+        token_buffer_free(&tokens);
+        if (count >= PARALLEL_CHECK_TOKENS) return 1;
+        source_free(source);
+        corpus.units *= 2;
+    }
+}
+
+// Every shape, once as generated and once with broken pieces written over it, and random programs
+// Returns 1 when every parser agrees
+static int check_parsers(void) {
+    int ok = 1;
+    for (int shape = 0; ok && shape < CORPUS_SHAPE_COUNT; shape++) {
+        Source source;
+        if (!generate_parallel_corpus(&source, shape)) return 0;
+        for (int broken = 0; ok && broken < 2; broken++) {
+            for (int i = 1; broken && ok && i < 8; i++) {
+                const char* piece = check_pieces[check_random() % CHECK_PIECES];
+                ok = source_edit(&source, source.length * i / 8, 0, piece, strlen(piece));
+            }
+            TokenBuffer tokens;
+            if (!ok || !lex_all(&tokens, &source)) {
+                ok = 0;
+                break;
+            }
+            char what[64];
+            snprintf(what, sizeof(what), "the %s%s shape", broken ? "broken " : "", corpus_shape_name(shape));
+            ok = check_parse_variants(&tokens, what);
+            token_buffer_free(&tokens);
+        }
+        source_free(&source);
+    }
+    for (int i = 0; ok && i < CHECK_PROGRAMS; i++) {
+        Source source;
+        TokenBuffer tokens;
+        if (!random_program(&source, 5 + check_random() % 80, 1)) return 0;
+        ok = lex_all(&tokens, &source);
+        if (ok) {
+            ok = check_parse_variants(&tokens, "a random program");
+            if (!ok) printf("%s\n", source.data);
+            token_buffer_free(&tokens);
+        }
+        source_free(&source);
+    }
+    return ok;
+}
+
+// Same kinds, tokens and children, whatever the nodes are numbered
+static int same_tree(const Ast* a, NodeId x, const Ast* b, NodeId y) {
+    if (x == NODE_NONE || y == NODE_NONE) return x == y;
+    Token s = ast_token(a, x), t = ast_token(b, y);
+    if (ast_kind(a, x) != ast_kind(b, y) || s.type != t.type || s.offset != t.offset || s.length != t.length) return 0;
+    if (!ast_is_sequence(a, x)) {
+        return same_tree(a, ast_left(a, x), b, ast_left(b, y)) && same_tree(a, ast_right(a, x), b, ast_right(b, y));
+    }
+    if (ast_child_count(a, x) != ast_child_count(b, y)) return 0;
+    for (uint32_t i = 0; i < ast_child_count(a, x); i++) {
+        if (!same_tree(a, ast_child(a, x, i), b, ast_child(b, y, i))) return 0;
+    }
+    return 1;
+}
+
+// Tokens and tree after an edit must be the ones a fresh lex_all and parse give
+static int check_edit(const Source* source, const TokenBuffer* tokens, const ParserState* parser, NodeId root) {
+    Source fresh;
+    TokenBuffer expected;
+    if (!source_from_string(&fresh, source->data, source->length)) return 0;
+    if (!lex_all(&expected, &fresh)) {
+        source_free(&fresh);
+        return 0;
+    }
+    int ok = same_tokens(&expected, tokens);
+    if (!ok) {
+        printf("lex_edit differs from lex_all on\n%s\n", source->data);
+    } else {
+        ParserState reparsed;
+        parser_init(&reparsed, &expected);
+        NodeId expected_root = parse(&reparsed);
+        ok = same_tree(&reparsed.ast, expected_root, &parser->ast, root) && same_diagnostics(&reparsed, parser);
+        if (!ok) printf("parse_edit differs from parse on\n%s\n", source->data);
+        parser_free(&reparsed);
+    }
+    token_buffer_free(&expected);
+    source_free(&fresh);
+    return ok;
+}
+
+// Random edits of random programs, each followed by lex_edit and parse_edit
+// Returns 1 when every edit leaves the tokens and tree of a fresh parse
+static int check_edits(void) {
+    int ok = 1;
+    for (int i = 0; ok && i < CHECK_PROGRAMS; i++) {
+        Source source;
+        TokenBuffer tokens;
+        if (!random_program(&source, 5 + check_random() % 80, 1)) return 0;
+        if (!lex_all(&tokens, &source)) {
+            source_free(&source);
+            return 0;
+        }
+        ParserState parser;
+        parser_init(&parser, &tokens);
+        NodeId root = parse(&parser);
+        for (int e = 0; ok && e < CHECK_EDITS; e++) {
+            size_t offset = check_random() % (source.length + 1);
+            size_t removed = check_random() % 4 ? check_random() % 6 : 0;
+            if (removed > source.length - offset) removed = source.length - offset;
+            const char* text = check_random() % 3 ? check_fragment(1) : "";
+            TokenEdit edit;
+            ok = lex_edit(&tokens, &source, offset, removed, text, strlen(text), &edit);
+            if (ok) {
+                root = parse_edit(&parser, root, &edit);
+                ok = check_edit(&source, &tokens, &parser, root);
+            }
+        }
+        parser_free(&parser);
+        token_buffer_free(&tokens);
+        source_free(&source);
+    }
+    return ok;
+}
+
+// Same severities, codes and messages in the same order, whatever their locations
+static int same_messages(const DiagSink* a, const DiagSink* b) {
+    if (a->count != b->count) return 0;
+    for (size_t i = 0; i < a->count; i++) {
+        const Diagnostic* x = &a->items[i];
+        const Diagnostic* y = &b->items[i];
+        if (x->severity != y->severity || x->phase != y->phase || x->code != y->code
+            || strcmp(diag_message(a, x), diag_message(b, y)) != 0) return 0;
+    }
+    return 1;
+}
+
+// The checker must reach the same verdict and messages on the hash-consed tree as on the plain one. Only the
+// locations may differ, a tree with shared nodes reports every use at its statement
+static int check_consed_semantics(TokenBuffer* tokens, const char* what) {
+    ParserState plain, consed;
+    parser_init(&plain, tokens);
+    parser_init(&consed, tokens);
+    parser_set_hash_consing(&consed, 1);
+    NodeId plain_root = parse(&plain);
+    NodeId consed_root = parse(&consed);
+    int ok = 1;
+    // Like the driver, only trees without syntax errors are analyzed
+    if (plain.diagnostic_count == 0) {
+        DiagSink expected, diagnostics;
+        diag_init(&expected, LOG_WARNING);
+        diag_init(&diagnostics, LOG_WARNING);
+        int verdict = analyze_semantics(&plain.ast, plain_root, &expected);
+        ok = analyze_semantics(&consed.ast, consed_root, &diagnostics) == verdict
+            && same_messages(&expected, &diagnostics);
+        if (!ok) printf("analyze_semantics differs on the hash-consed tree of %s\n", what);
+        diag_free(&diagnostics);
+        diag_free(&expected);
+    }
+    parser_free(&consed);
+    parser_free(&plain);
+    return ok;
+}
+
+// Every shape and random programs of statements, so that names are undeclared, redeclared or uninitialized
+// Returns 1 when hash-consing never changes what the checker reports
+static int check_hash_consing(void) {
+    int ok = 1;
+    for (int shape = 0; ok && shape < CORPUS_SHAPE_COUNT; shape++) {
+        CorpusOptions corpus = {shape, 200, 8};
+        Source source;
+        TokenBuffer tokens;
+        if (!corpus_generate(&source, &corpus)) return 0;
+        ok = lex_all(&tokens, &source);
+        if (ok) {
+            ok = check_consed_semantics(&tokens, corpus_shape_name(shape));
+            token_buffer_free(&tokens);
+        }
+        source_free(&source);
+    }
+    for (int i = 0; ok && i < CHECK_PROGRAMS; i++) {
+        Source source;
+        TokenBuffer tokens;
+        if (!random_program(&source, 5 + check_random() % 80, 0)) return 0;
+        ok = lex_all(&tokens, &source);
+        if (ok) {
+            ok = check_consed_semantics(&tokens, "a random program");
+            if (!ok) printf("%s\n", source.data);
+            token_buffer_free(&tokens);
+        }
+        source_free(&source);
+    }
+    return ok;
+}
+
+/* --- REPORT --- */
+// Growth of time against work between the smallest and largest size, 1 for linear
+static double scaling_exponent(double first_time, size_t first_work, double last_time, size_t last_work) {
+    if (first_time <= 0 || last_time <= 0 || last_work <= first_work) return 0;
+    return log(last_time / first_time) / log((double)last_work / first_work);
+}
+
+static void print_scaling(const char* phase, double exponent) {
+    printf("  %s %.2f%s", phase, exponent, exponent > SUPERLINEAR_EXPONENT ? " (SUPER-LINEAR)" : "");
+}
+
+static int bench_shape(CorpusShape shape, const BenchOptions* options) {
+    BenchRow rows[MAX_STEPS];
+    CorpusOptions corpus = {shape, options->units, options->depth};
+    printf("\n%s (depth %d, %d parse threads)\n", corpus_shape_name(shape), options->depth, parse_threads);
+    printf("%10s %12s %10s %12s %12s %12s %12s %10s %8s %7s %10s %13s %14s\n", "units", "bytes", "lex MB/s", "tokens/s",
+           "nodes/s", "iter nodes/s", "par nodes/s", "AST B/node", "mallocs", "cons %", "edit us", "load nodes/s",
+           "symbols/s");
+    for (int i = 0; i < options->steps; i++) {
+        BenchRow* row = &rows[i];
+        if (!bench_size(&corpus, row)) {
+            printf("Memory allocation failed.\n");
+            return 0;
+        }
+        printf("%10zu %12zu %10.1f %12.0f %12.0f %12.0f %12.0f %10.1f %8zu %7.1f %10.1f %13.0f %14.0f%s\n",
+               row->units, row->bytes, row->bytes / row->lex / 1e6, row->tokens / row->lex, row->nodes / row->parse,
+               row->nodes / row->parse_iterative, row->nodes / row->parse_parallel, (double)row->ast_bytes / row->nodes,
+               row->mallocs, 100.0 * row->cons_nodes / row->nodes, row->edit * 1e6, row->nodes / row->cache_load, row->symbols / row->semantic,
+               row->steady_mallocs ? " (AST NOT REUSED)" : "");
+        corpus.units *= 2;
+    }
+    if (options->steps > 1) {
+        BenchRow* first = &rows[0];
+        BenchRow* last = &rows[options->steps - 1];
+        printf("scaling:");
+        print_scaling("lex", scaling_exponent(first->lex, first->tokens, last->lex, last->tokens));
+        print_scaling("parse", scaling_exponent(first->parse, first->nodes, last->parse, last->nodes));
+        print_scaling("iter", scaling_exponent(first->parse_iterative, first->nodes, last->parse_iterative, last->nodes));
+        print_scaling("par", scaling_exponent(first->parse_parallel, first->nodes, last->parse_parallel, last->nodes));
+        print_scaling("edit", scaling_exponent(first->edit, first->bytes, last->edit, last->bytes));
+        print_scaling("load", scaling_exponent(first->cache_load, first->nodes, last->cache_load, last->nodes));
+        print_scaling("semantic", scaling_exponent(first->semantic, first->nodes, last->semantic, last->nodes));
+        printf("\n");
+    }
+    return 1;
+}
+
+static void* bench_run(void* arg) {
+    BenchOptions* options = arg;
+    long ok = 1;
+    for (int shape = 0; shape < CORPUS_SHAPE_COUNT && ok; shape++) {
+        if (options->shape < 0 || options->shape == shape) ok = bench_shape(shape, options);
+    }
+    return (void*)ok;
+}
+
+// Write one generated program to a file instead of benchmarking
+static int dump_corpus(const BenchOptions* options) {
+    CorpusOptions corpus = {options->shape < 0 ? CORPUS_FLAT : options->shape, options->units, options->depth};
+    Source source;
+    if (!corpus_generate(&source, &corpus)) return 0;
+    FILE* file = fopen(options->dump, "wb");
+    if (file == NULL) {
+        printf("Error opening file\n");
+        source_free(&source);
+        return 0;
+    }
+    fwrite(source.data, 1, source.length, file);
+    fclose(file);
+    source_free(&source);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = {-1, 500, 4, 16, 0, NULL};
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--shape") == 0 && value) {
+            options.shape = strcmp(value, "all") == 0 ? -1 : corpus_shape_from_name(value);
+            if (options.shape < 0 && strcmp(value, "all") != 0) {
+                printf("Unknown shape '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--units") == 0 && value) {
+            options.units = strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--steps") == 0 && value) {
+            options.steps = atoi(value);
+        } else if (strcmp(argv[i], "--depth") == 0 && value) {
+            options.depth = atoi(value);
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            options.threads = atoi(value);
+        } else if (strcmp(argv[i], "--dump") == 0 && value) {
+            options.dump = value;
+        } else {
+            printf("usage: %s [--shape NAME|all] [--units N] [--steps K] [--depth D] [--threads T] [--dump FILE]\n", argv[0]);
+            printf("shapes:");
+            for (int shape = 0; shape < CORPUS_SHAPE_COUNT; shape++) printf(" %s", corpus_shape_name(shape));
+            printf("\n");
+            return 1;
+        }
+        i++;
+    }
+    if (options.units < 1) options.units = 1;
+    if (options.steps < 1) options.steps = 1;
+    if (options.steps > MAX_STEPS) options.steps = MAX_STEPS;
+    if (options.dump) return dump_corpus(&options) ? 0 : 1;
+    if (!check_lex_parallel() || !check_parsers() || !check_edits() || !check_hash_consing()) return 1;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    parse_threads = options.threads > 0 ? options.threads : cores > 1 ? (int)cores : 1;
+
+    // Run on a thread with a large stack so deeply nested corpora survive the recursive descent
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, BENCH_STACK);
+    pthread_t thread;
+    void* ok;
+    if (pthread_create(&thread, &attributes, bench_run, &options) == 0) {
+        pthread_join(thread, &ok);
+    } else {
+        ok = bench_run(&options);
+    }
+    pthread_attr_destroy(&attributes);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/* corpus.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "corpus.h"
+
+static const char* shape_names[CORPUS_SHAPE_COUNT] = {"flat", "nested", "expression", "scopes", "strings"};
+
+const char* corpus_shape_name(CorpusShape shape) {
+    return shape < CORPUS_SHAPE_COUNT ? shape_names[shape] : "unknown";
+}
+
+int corpus_shape_from_name(const char* name) {
+    for (int i = 0; i < CORPUS_SHAPE_COUNT; i++) {
+        if (strcmp(shape_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+/* --- OUTPUT BUFFER --- */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} Buffer;
+
+static void append(Buffer* buffer, const char* format, ...) {
+    if (buffer->failed) return;
+    while (1) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+        if (written < 0) {
+            buffer->failed = 1;
+            return;
+        }
+        if (buffer->length + written < buffer->capacity) {
+            buffer->length += written;
+            return;
+        }
+        size_t capacity = (buffer->capacity + written) * 2;
+        char* data = realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+/* --- SHAPES --- */
+static void flat_unit(Buffer* out, size_t k) {
+    append(out, "int v%zu;\nv%zu = %zu * 3 + 1;\nprint(v%zu + %zu);\n", k, k, k % 1000, k, k % 7);
+}
+
+static void nested_unit(Buffer* out, size_t k, int depth) {
+    for (int level = 0; level < depth; level++) {
+        append(out, "%*s", level * 2, "");
+        switch (level % 3) {
+            case 0: append(out, "if (x < %d) {\n", level + 10); break;
+            case 1: append(out, "while (x > %d) {\n", level); break;
+            default: append(out, "repeat {\n"); break;
+        }
+    }
+    append(out, "%*sx = x + %zu;\n", depth * 2, "", k % 10 + 1);
+    for (int level = depth - 1; level >= 0; level--) {
+        append(out, "%*s", level * 2, "");
+        if (level % 3 == 2) {
+            append(out, "} until (x == %d);\n", level);
+        } else {
+            append(out, "}\n");
+        }
+    }
+}
+
+static void expression_unit(Buffer* out, size_t k, int depth) {
+    static const char* operators[] = {" + ", " * ", " ^^ "};
+    append(out, "x = ");
+    for (int i = 0; i < depth; i++) {
+        if (i > 0) append(out, "%s", operators[(i + k) % 3]);
+        if (i % 3 == 0) {
+            append(out, "x");
+        } else {
+            append(out, "%d", (int)((i * 7 + k) % 100));
+        }
+    }
+    append(out, ";\n");
+}
+
+static void scopes_unit(Buffer* out, size_t k, int depth) {
+    append(out, "int g%zu;\ng%zu = %zu;\n{\n", k, k, k % 1000);
+    for (int j = 0; j < depth; j++) {
+        append(out, "  int l%d;\n  l%d = g%zu + %d;\n", j, j, k, j);
+    }
+    append(out, "}\n");
+}
+
+static void strings_unit(Buffer* out, size_t k) {
+    append(out, "/* Block comment %zu: the quick brown fox jumps over the lazy dog.\n"
+                "   It spans a few lines and holds \"quotes\", 'ticks' and * stars * to scan past. */\n", k);
+    append(out, "string s%zu;\n", k);
+    append(out, "s%zu = \"Line %zu of the corpus\\twith tabs, \\\"quotes\\\" and a backslash \\\\ to decode\\n\";\n",
+           k, k);
+    append(out, "# line comment after string %zu with some more filler text for the scanner to skip\n", k);
+    append(out, "char c%zu;\nc%zu = '\\t';\n", k, k);
+}
+
+int corpus_generate(Source* source, const CorpusOptions* options) {
+    Buffer out = {NULL, 0, 0, 0};
+    int depth = options->depth > 0 ? options->depth : 1;
+    if (options->shape == CORPUS_NESTED || options->shape == CORPUS_EXPRESSION) {
+        append(&out, "int x;\nx = 1;\n");
+    }
+    for (size_t k = 0; k < options->units && !out.failed; k++) {
+        switch (options->shape) {
+            case CORPUS_FLAT: flat_unit(&out, k); break;
+            case CORPUS_NESTED: nested_unit(&out, k, depth); break;
+            case CORPUS_EXPRESSION: expression_unit(&out, k, depth); break;
+            case CORPUS_SCOPES: scopes_unit(&out, k, depth); break;
+            default: strings_unit(&out, k); break;
+        }
+    }
+    if (out.failed) {
+        free(out.data);
+        return 0;
+    }
+    int ok = source_from_string(source, out.data ? out.data : "", out.length);
+    free(out.data);
+    return ok;
+}
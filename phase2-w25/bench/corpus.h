@@ -0,0 +1,32 @@
+/* corpus.h */
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include "../include/source.h"
+
+/* Synthetic SeaPlus+ programs for the benchmarks
+ * Every program is valid (it lexes, parses and passes semantic analysis), and its size grows
+ * linearly with the number of units, so any super-linear time comes from the frontend. */
+typedef enum {
+    CORPUS_FLAT,        // Long list of declarations, assignments and prints in one scope
+    CORPUS_NESTED,      // if / while / repeat blocks nested `depth` deep
+    CORPUS_EXPRESSION,  // Assignments of `depth` term + * ^^ chains
+    CORPUS_SCOPES,      // One global per unit plus a block with `depth` local declarations
+    CORPUS_STRINGS,     // String and char literals with escapes, block and line comments
+    CORPUS_SHAPE_COUNT
+} CorpusShape;
+
+typedef struct {
+    CorpusShape shape;
+    size_t units;       // Number of repeated pieces
+    int depth;          // Nesting depth, expression terms or declarations per block
+} CorpusOptions;
+
+// Generate a program into source (free it with source_free), returns 1 on success and 0 when out of memory
+int corpus_generate(Source* source, const CorpusOptions* options);
+const char* corpus_shape_name(CorpusShape shape);
+// Shape with the given name, -1 if there is none
+int corpus_shape_from_name(const char* name);
+
+#endif /* CORPUS_H */
@@ -0,0 +1,33 @@
+/* arena.h */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator
+ * Memory comes from a chain of blocks that double in size, so allocating is a pointer bump and
+ * releasing everything frees a handful of blocks however many allocations were made. Nothing is
+ * freed on its own. arena_reset rewinds to the first block and keeps the chain, so filling the
+ * arena again to the same size makes no malloc calls at all. */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* first;
+    ArenaBlock* current;        // Block being bumped, later blocks are free for reuse after a reset
+    char* next;                 // Next free byte in current
+    char* end;                  // End of current
+    size_t block_size;          // Size of the next block to allocate
+    size_t allocations;         // arena_alloc calls since the last reset
+    size_t mallocs;             // Blocks allocated over the life of the arena
+} Arena;
+
+// Start an empty arena, the first block is allocated on first use
+void arena_init(Arena* arena, size_t block_size);
+// Allocate size bytes aligned for any type, NULL when out of memory
+void* arena_alloc(Arena* arena, size_t size);
+// Forget every allocation but keep the blocks for reuse
+void arena_reset(Arena* arena);
+// Release every block
+void arena_free(Arena* arena);
+
+#endif /* ARENA_H */
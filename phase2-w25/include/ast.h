@@ -0,0 +1,156 @@
+/* ast.h */
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tokens.h"
+#include "source.h"
+#include "intern.h"
+#include "lexer.h"
+
+// Basic node types for AST
+typedef enum {
+    AST_PROGRAM,        // Program node
+    AST_ASSIGN,         // Assignment (x = 5)
+    AST_PRINT,          // Print statement
+    AST_NUMBER,         // Number literal
+    AST_IDENTIFIER,     // Variable name
+    AST_INT,            // Integers
+    AST_STRINGCHAR,     // String or Character
+    // Control Flow node types
+    AST_IF,             //If statement
+    AST_ELSE,           //Else statement
+    AST_WHILE,          //while loop
+    AST_REPEAT,         //repeat...
+    AST_UNTIL,          //until loop
+    AST_BREAK,          //break statement
+    // Block statements for loops
+    AST_BLOCK,         //block {...}
+    //Expressions
+    AST_EXPRESSION,    // Unresolved state for AST nodes in expression parser
+    AST_BINOP,         // Binary operators
+    AST_UNARYOP,       // Unary operators (i think just !)
+    AST_COMPARISON,    // Comparisons
+    AST_LOGIC_OP,      // Logical operators
+    AST_CAST,          // typecasting, not sure if were doing this
+    //Extra
+    AST_NULL,          // null values
+    AST_FACTORIAL,     // factorial
+    AST_ERROR          // statement or expression that failed to parse, left holds what was parsed of it
+    // TODO: Add more node types as needed
+} ASTNodeType;
+
+// Index of a node in an Ast
+typedef uint32_t NodeId;
+#define NODE_NONE 0     // Missing child, slot 0 of every Ast is reserved for it
+
+/* Compact AST
+ * Nodes live in parallel arrays indexed by NodeId, 13 bytes a node. A node keeps the index of its token
+ * instead of a copy, the token's text, location and atom are read from the TokenBuffer on demand.
+ * Children are indices into the same arrays, so a tree is a few contiguous blocks that are freed at once.
+ * AST_PROGRAM and AST_BLOCK are sequences: their statements sit next to each other in `children`, with
+ * left holding the first position and right the count, so walking a statement list is a linear scan. */
+typedef struct {
+    const TokenBuffer* tokens;  // Buffer the node tokens index into
+    uint8_t* kind;              // ASTNodeType
+    uint32_t* token;            // Token index in tokens
+    NodeId* left;               // Left child
+    NodeId* right;              // Right child
+    size_t count;               // Nodes including the NODE_NONE slot
+    size_t capacity;
+    NodeId* children;           // Statements of every sequence node
+    size_t child_count;
+    size_t child_capacity;
+    size_t allocations;         // Times the arrays were (re)allocated, refilling a reset Ast adds none
+    int shared;                 // Set once hash-consing gave a node several parents, its token is then only the first use
+} Ast;
+
+void ast_init(Ast* ast, const TokenBuffer* tokens);
+// Add a node for token index with no children, NODE_NONE when out of memory
+NodeId ast_add(Ast* ast, ASTNodeType kind, size_t token);
+// Make node a sequence of count statements, returns 1 on success and 0 when out of memory
+int ast_set_children(Ast* ast, NodeId node, const NodeId* children, size_t count);
+// Make room for nodes nodes (counting the NODE_NONE slot) and children statements, 1 on success and 0 when out of memory
+int ast_reserve(Ast* ast, size_t nodes, size_t children);
+/* Copy every node of from into ast starting at node, and its statement lists starting at child, renumbering
+ * the children to match. ast must already have room for them, and its counts are left to the caller, so trees
+ * built separately can be stitched into one with disjoint ranges copied at the same time. */
+void ast_copy(Ast* ast, NodeId node, size_t child, const Ast* from);
+// Drop every node but keep the arrays for the next tree
+void ast_reset(Ast* ast);
+void ast_free(Ast* ast);
+// Bytes held by the node arrays
+size_t ast_memory(const Ast* ast);
+
+/* Pre-order walk with an explicit stack, so its depth is bounded by memory and not the C stack.
+ * Statements of a sequence come in order, other nodes give their left subtree before their right one.
+ *   AstWalk walk;
+ *   ast_walk_begin(&walk, ast, root, 0);
+ *   while (ast_walk_next(&walk, &node, &depth)) ...
+ *   ast_walk_end(&walk); */
+typedef struct {
+    NodeId node;
+    int depth;
+} AstWalkEntry;
+
+typedef struct {
+    const Ast* ast;
+    AstWalkEntry* stack;
+    size_t count;
+    size_t capacity;
+    int failed;                 // Set when the stack could not grow, the walk stops early
+} AstWalk;
+
+void ast_walk_begin(AstWalk* walk, const Ast* ast, NodeId root, int depth);
+// Next node and its depth below the root, returns 0 when the walk is over
+int ast_walk_next(AstWalk* walk, NodeId* node, int* depth);
+void ast_walk_end(AstWalk* walk);
+
+/* --- TRAVERSAL HELPERS --- */
+static inline ASTNodeType ast_kind(const Ast* ast, NodeId node) {
+    return (ASTNodeType)ast->kind[node];
+}
+
+static inline NodeId ast_left(const Ast* ast, NodeId node) {
+    return ast->left[node];
+}
+
+static inline NodeId ast_right(const Ast* ast, NodeId node) {
+    return ast->right[node];
+}
+
+static inline Token ast_token(const Ast* ast, NodeId node) {
+    return token_at(ast->tokens, ast->token[node]);
+}
+
+// Type of the node's token, without building the whole Token
+static inline TokenType ast_token_type(const Ast* ast, NodeId node) {
+    return (TokenType)ast->tokens->types[ast->token[node]];
+}
+
+static inline int ast_is_sequence(const Ast* ast, NodeId node) {
+    return ast->kind[node] == AST_PROGRAM || ast->kind[node] == AST_BLOCK;
+}
+
+// Statement count and i-th statement of a sequence node
+static inline uint32_t ast_child_count(const Ast* ast, NodeId node) {
+    return ast->right[node];
+}
+
+static inline NodeId ast_child(const Ast* ast, NodeId node, uint32_t i) {
+    return ast->children[ast->left[node] + i];
+}
+
+// Interned text of the node's token, ATOM_NONE for keywords and delimiters
+static inline Atom ast_atom(const Ast* ast, NodeId node) {
+    Atom atom = ast->tokens->atoms[ast->token[node]];
+    return ast->tokens->atom_map ? ast->tokens->atom_map[atom] : atom;
+}
+
+// Line and column of the node's token, only looked up for diagnostics
+static inline SourceLocation ast_location(const Ast* ast, NodeId node) {
+    return token_location(ast->tokens, ast->token[node]);
+}
+
+#endif /* AST_H */
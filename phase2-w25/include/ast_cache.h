@@ -0,0 +1,44 @@
+/* ast_cache.h */
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "source.h"
+#include "lexer.h"
+#include "ast.h"
+#include "parser.h"
+
+/* Binary AST cache
+ * A parsed source saved to a file that is used again by mapping it read-only, with no decoding pass. The file
+ * holds the token and node arrays and the statement lists as they sit in memory, each at an offset from the
+ * start of the file, plus a table of the distinct token texts that the token atoms number, with their intern
+ * hashes. Loading checks the header, points a TokenBuffer and an Ast at the arrays and interns the string table
+ * without hashing it again, so atoms compare and print as if the source had been lexed again. print_ast and
+ * analyze_semantics run on the mapped tree.
+ * A file is keyed by source_hash of the source it was parsed from. A file of another version, byte order or
+ * source is refused, so a stale cache is never used. Token text and locations are still read from the source. */
+
+#define AST_CACHE_VERSION 2
+
+// A tree loaded from a cache file, its arrays are read-only and must not be freed, reset or edited
+// tokens and ast refer to each other, so the cache must stay where it was loaded
+typedef struct {
+    void* image;                // Mapping (or copy) of the file
+    size_t size;
+    int mapped;
+    TokenBuffer tokens;         // Arrays point into the image
+    Ast ast;
+    NodeId root;
+    Atom* atoms;                // Atom of every string of the table, the tokens' atom_map
+} AstCache;
+
+// Save the tree of root that parser built, returns 1 on success and 0 on failure
+// Trees with syntax errors are not saved. The file is written next to path and renamed over it
+int ast_cache_write(const ParserState* parser, NodeId root, const char* path);
+// Map the cache file at path for source (the buffer the tree was parsed from)
+// Returns 1 when it holds the tree of this source, 0 when it is missing, stale or unreadable
+int ast_cache_load(AstCache* cache, const Source* source, const char* path);
+void ast_cache_free(AstCache* cache);
+
+#endif /* AST_CACHE_H */
@@ -0,0 +1,73 @@
+/* cfg.h */
+#ifndef CFG_H
+#define CFG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+
+/* Control-flow graph
+ * Basic blocks of a program, built in one pass over its statement lists. A block holds items in source order:
+ * simple statements (declarations, assignments, prints, breaks), and control statements standing for the
+ * evaluation of their condition.
+ *   if       its condition ends the block before it, which branches to the body and past it, or to the body
+ *            of an else that comes right after the if. A lone else is a body that may or may not run
+ *   while    its condition is a block of its own, branching to the body and past the loop, and the end of the
+ *            body jumps back to it
+ *   repeat   the body comes first, its condition ends the body and jumps back to the body's first block
+ *   break    jumps past the innermost loop, statements after it start a block nothing leads to
+ * Blocks are numbered in source order, CFG_ENTRY is the first and cfg_exit() the last. Items, successors and
+ * predecessors are kept in flat arrays with an offset per block, so passes over it never chase pointers and a
+ * tree with shared (hash-consed) expressions works as is: items are statements, which are never shared. */
+
+typedef uint32_t BlockId;
+#define CFG_ENTRY 0
+
+typedef struct {
+    const Ast* ast;
+    NodeId* items;              // Items of every block, block after block
+    size_t item_count;
+    uint32_t* block_items;      // First item of each block, block_count + 1 entries
+    size_t block_count;
+    uint32_t* successor_start;  // First successor of each block, block_count + 1 entries
+    BlockId* successors;
+    uint32_t* predecessor_start;
+    BlockId* predecessors;
+    size_t edge_count;
+} Cfg;
+
+// Build the graph of the program at root, returns 1 on success and 0 when out of memory
+int cfg_build(Cfg* cfg, const Ast* ast, NodeId root);
+void cfg_free(Cfg* cfg);
+// Print every block with its items and successors (for debugging)
+void print_cfg(const Cfg* cfg);
+
+static inline BlockId cfg_exit(const Cfg* cfg) {
+    return (BlockId)(cfg->block_count - 1);
+}
+
+static inline uint32_t cfg_item_count(const Cfg* cfg, BlockId block) {
+    return cfg->block_items[block + 1] - cfg->block_items[block];
+}
+
+static inline NodeId cfg_item(const Cfg* cfg, BlockId block, uint32_t i) {
+    return cfg->items[cfg->block_items[block] + i];
+}
+
+static inline uint32_t cfg_successor_count(const Cfg* cfg, BlockId block) {
+    return cfg->successor_start[block + 1] - cfg->successor_start[block];
+}
+
+static inline BlockId cfg_successor(const Cfg* cfg, BlockId block, uint32_t i) {
+    return cfg->successors[cfg->successor_start[block] + i];
+}
+
+static inline uint32_t cfg_predecessor_count(const Cfg* cfg, BlockId block) {
+    return cfg->predecessor_start[block + 1] - cfg->predecessor_start[block];
+}
+
+static inline BlockId cfg_predecessor(const Cfg* cfg, BlockId block, uint32_t i) {
+    return cfg->predecessors[cfg->predecessor_start[block] + i];
+}
+
+#endif /* CFG_H */
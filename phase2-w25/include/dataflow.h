@@ -0,0 +1,49 @@
+/* dataflow.h */
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+#include "cfg.h"
+#include "resolve.h"
+#include "type_table.h"
+
+/* Definite initialization
+ * Forward must-analysis over a Cfg: a variable is initialized at a point when every path from the entry to that
+ * point assigns it after its declaration. Its declaration makes it uninitialized again, so a variable declared in
+ * a loop body starts out uninitialized on every iteration. An assignment initializes its variable only when the
+ * value has the variable's type, as the checker requires.
+ * Sets are dense bitsets with a bit per frame slot (resolve.h) rather than per SymbolId: a slot holds one
+ * variable at any point and the variable's declaration clears the bit, so frame_size bits are enough however
+ * many variables the program declares in all. The set on entry to every block is solved with a FIFO worklist
+ * seeded with the blocks in source order, so straight-line code and ifs settle in one pass and each loop
+ * level costs about one more.
+ * Afterwards every item is replayed once and the names it reads that may be uninitialized are kept, sorted, as
+ * (item, symbol) pairs. Items are statements, so a name node shared by several statements of a hash-consed
+ * tree is answered for each of them. */
+
+typedef struct {
+    NodeId item;                // Statement or control statement whose condition reads the name
+    SymbolId symbol;
+} UninitializedUse;
+
+typedef struct {
+    const Cfg* cfg;
+    const Resolution* resolution;
+    const TypeTable* types;
+    size_t words;               // 64-bit words of a set
+    uint64_t* in;               // Slots initialized on entry to each block, words per block
+    UninitializedUse* uses;     // Sorted by item, then symbol
+    size_t use_count;
+    size_t use_capacity;
+    size_t visits;              // Blocks taken off the worklist
+} InitAnalysis;
+
+// Solve definite initialization over cfg, returns 1 on success and 0 when out of memory
+int analyze_initialization(InitAnalysis* analysis, const Cfg* cfg, const Resolution* resolution, const TypeTable* types);
+void init_analysis_free(InitAnalysis* analysis);
+// Whether the name node read by item may not be initialized there
+int maybe_uninitialized(const InitAnalysis* analysis, NodeId item, NodeId name);
+
+#endif /* DATAFLOW_H */
@@ -0,0 +1,81 @@
+/* diagnostics.h */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "source.h"
+
+/* Diagnostics
+ * The lexer, parser and checker report into a DiagSink instead of printing. A diagnostic keeps its severity,
+ * the phase and error code that raised it and where it was found, and its message is formatted once into the
+ * sink's text buffer. Nothing is written until diag_emit prints them all, as text or as JSON.
+ * Tracing of what the checker does sits behind the sink's log level. Below LOG_TRACE a trace is one compare
+ * and its arguments are not even evaluated, so checking a large file does no I/O per statement. */
+
+typedef enum {
+    DIAG_ERROR,
+    DIAG_WARNING             // Reported, but does not make the phase fail
+} DiagSeverity;
+
+typedef enum {
+    DIAG_LEXICAL,            // code is an ErrorType
+    DIAG_SYNTAX,             // code is a ParseError
+    DIAG_SEMANTIC            // code is a SemanticErrorType
+} DiagPhase;
+
+typedef enum {
+    DIAG_TEXT,               // One line each, as the phases always printed them
+    DIAG_JSON                // One array of objects with severity, code, line, column and message
+} DiagFormat;
+
+typedef enum {
+    LOG_ERROR,               // Errors are emitted
+    LOG_WARNING,             // Errors and warnings are emitted
+    LOG_TRACE                // Errors and warnings are emitted, and the checker traces every step on stdout
+} LogLevel;
+
+typedef struct {
+    uint8_t severity;        // DiagSeverity
+    uint8_t phase;           // DiagPhase
+    uint16_t code;
+    SourceLocation location;
+    uint32_t message;        // Offset of its text in the sink's buffer
+} Diagnostic;
+
+typedef struct {
+    Diagnostic* items;       // In the order they were reported
+    size_t count;
+    size_t capacity;
+    char* text;              // Messages, each ending with a NUL
+    size_t text_length;
+    size_t text_capacity;
+    size_t errors;           // Diagnostics of severity DIAG_ERROR
+    LogLevel level;
+} DiagSink;
+
+void diag_init(DiagSink* sink, LogLevel level);
+// Record a diagnostic, its message is formatted like printf
+void diag_report(DiagSink* sink, DiagSeverity severity, DiagPhase phase, int code, SourceLocation location,
+                 const char* format, ...) __attribute__((format(printf, 6, 7)));
+// Write every diagnostic the log level lets through to out
+void diag_emit(const DiagSink* sink, FILE* out, DiagFormat format);
+// Drop every diagnostic but keep the buffers for the next input
+void diag_clear(DiagSink* sink);
+void diag_free(DiagSink* sink);
+
+static inline int diag_tracing(const DiagSink* sink) {
+    return sink->level >= LOG_TRACE;
+}
+
+// printf when the sink traces, nothing at all otherwise
+#define DIAG_TRACE(sink, ...) do { \
+        if (diag_tracing(sink)) printf(__VA_ARGS__); \
+    } while (0)
+
+static inline const char* diag_message(const DiagSink* sink, const Diagnostic* diagnostic) {
+    return sink->text + diagnostic->message;
+}
+
+#endif /* DIAGNOSTICS_H */
@@ -0,0 +1,32 @@
+/* intern.h */
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Global string interner
+ * Every distinct string is stored once and named by a 32-bit atom, so two strings are equal exactly
+ * when their atoms are. The table is split into shards picked by hash, each with its own lock,
+ * open-addressing table and string arena, so many threads can intern at once. Atoms and their
+ * text stay valid for the life of the process. */
+typedef uint32_t Atom;
+
+#define ATOM_NONE 0         // Never returned by intern, marks "no atom"
+
+// Atom for text[0..length), adding a copy of the text the first time it is seen. ATOM_NONE if out of memory
+Atom intern(const char* text, size_t length);
+// Same with the intern_hash of the text already known, so it is not hashed again
+Atom intern_hashed(const char* text, size_t length, uint32_t hash);
+// Hash intern files text[0..length) under, it only changes with the interner
+uint32_t intern_hash(const char* text, size_t length);
+// Atom for a NUL-terminated string
+Atom intern_cstr(const char* text);
+// NUL-terminated text of an atom, "" for ATOM_NONE
+const char* atom_text(Atom atom);
+// Length of the text of an atom
+size_t atom_length(Atom atom);
+// Number of distinct strings interned so far
+size_t intern_count(void);
+
+#endif /* INTERN_H */
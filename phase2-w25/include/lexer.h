@@ -3,10 +3,86 @@
 #define LEXER_H
 
 #include "tokens.h"
+#include "source.h"
+#include "intern.h"
+#include "diagnostics.h"
+
+// Lexer context for one input, every get_next_token call reads and updates only this state
+// so any number of inputs can be lexed at once (one LexerState per input)
+typedef struct {
+    const Source* source;
+    int pos;                // Offset of the next byte to scan
+    char last_token_type;   // For checking consecutive operators
+    int unclosed_comment;   // Set once the end of input was reached inside a comment
+} LexerState;
 
 // Lexer functions that need to be visible to other files
-Token get_next_token(const char* input, int* pos);
-void print_token(Token token);
-void print_error(ErrorType error, int line, const char* lexeme);
+void lexer_init(LexerState* lexer, const Source* source);
+Token get_next_token(LexerState* lexer);
+void print_token(const Source* source, Token token);
+void print_error(ErrorType error, SourceLocation location, const char* lexeme, int length);
+
+// Token stream of a whole source in struct-of-arrays form, entry i of every array describes token i
+// The last token is always TOKEN_EOF
+typedef struct {
+    const Source* source;
+    uint8_t* types;         // TokenType
+    uint8_t* errors;        // ErrorType
+    uint32_t* offsets;
+    uint32_t* lengths;
+    Atom* atoms;            // Interned token text, see token_atom
+    const Atom* atom_map;   // Atom of each entry of atoms when they number a string table (cached trees), else NULL
+    size_t count;
+    size_t capacity;
+} TokenBuffer;
+
+// Lexes the whole source into buffer with the get_next_token loop, returns 1 on success and 0 when out of memory
+int lex_all(TokenBuffer* buffer, const Source* source);
+// Same tokens (and warnings) as lex_all, but the source is split into up to `threads` chunks at newlines
+// outside strings and comments and each chunk is lexed on its own thread
+int lex_parallel(TokenBuffer* buffer, const Source* source, int threads);
+// Tokens an edit replaced: old tokens [first, first + removed) became [first, first + inserted), the ones after
+// them are kept and moved by inserted - removed
+typedef struct {
+    size_t first;
+    size_t removed;
+    size_t inserted;
+} TokenEdit;
+
+// Replaces `removed` bytes at offset of source (the source buffer was lexed from) with length bytes of text and
+// re-lexes from the last token before the edit until the tokens line up with the old ones again, so lexing depends
+// on the size of the edit. The source bytes and tokens after the edit are still moved and their offsets rebased,
+// which is linear in the source. The buffer ends up as lex_all would lex the edited source.
+// Returns 1 on success, 0 for an edit out of range (nothing is changed) or when out of memory (the buffer is then
+// freed like lex_all leaves it)
+int lex_edit(TokenBuffer* buffer, Source* source, size_t offset, size_t removed, const char* text, size_t length,
+             TokenEdit* edit);
+// Report the error of every TOKEN_ERROR token of buffer into sink, with the messages print_error prints.
+// An unclosed comment is reported as a warning
+void report_lexical_errors(const TokenBuffer* buffer, DiagSink* sink);
+// Line and column of token index, see source_location
+SourceLocation token_location(const TokenBuffer* buffer, size_t index);
+// Token index as get_next_token returned it, indexes past the end give the TOKEN_EOF token
+Token token_at(const TokenBuffer* buffer, size_t index);
+// Grows the arrays of buffer to hold capacity tokens, returns 1 on success
+int token_buffer_reserve(TokenBuffer* buffer, size_t capacity);
+void token_buffer_free(TokenBuffer* buffer);
+// Atom of the text of a token, ATOM_NONE for keywords, delimiters and EOF
+Atom token_atom(const char* source, Token token);
+
+// Token text helpers, source must be the buffer the token was lexed from
+// TOKEN_TEXT expands to the two arguments of a "%.*s" conversion, "EOF" at end of input
+#define TOKEN_TEXT(source, token) \
+    ((token).type == TOKEN_EOF ? 3 : (int)(token).length), \
+    ((token).type == TOKEN_EOF ? "EOF" : (source) + (token).offset)
+int token_equals(const char* source, Token token, const char* text);
+// Decodes the value of a string or char literal (escapes resolved, quotes removed) into out
+// Other tokens are copied as is. Returns the full decoded length, out is always NUL-terminated
+int token_decode(const char* source, Token token, char* out, int capacity);
+// Prints the token as it reads in messages: literal values decoded, strings kept in quotes
+void print_token_text(const char* source, Token token);
+
+// Table-driven engine behind get_next_token when built with -DLEXER_DFA
+Token dfa_next_token(LexerState* lexer);
 
 #endif /* LEXER_H */
\ No newline at end of file
@@ -3,37 +3,10 @@
 #define PARSER_H
 
 #include "tokens.h"
-
-// Basic node types for AST
-typedef enum {
-    AST_PROGRAM,        // Program node
-    AST_ASSIGN,         // Assignment (x = 5)
-    AST_PRINT,          // Print statement
-    AST_NUMBER,         // Number literal
-    AST_IDENTIFIER,     // Variable name
-    AST_INT,            // Integers
-    AST_STRINGCHAR,     // String or Character
-    // Control Flow node types
-    AST_IF,             //If statement
-    AST_ELSE,           //Else statement
-    AST_WHILE,          //while loop
-    AST_REPEAT,         //repeat...
-    AST_UNTIL,          //until loop
-    AST_BREAK,          //break statement
-    // Block statements for loops
-    AST_BLOCK,         //block {...}
-    //Expressions
-    AST_EXPRESSION,    // Unresolved state for AST nodes in expression parser
-    AST_BINOP,         // Binary operators
-    AST_UNARYOP,       // Unary operators (i think just !)
-    AST_COMPARISON,    // Comparisons
-    AST_LOGIC_OP,      // Logical operators
-    AST_CAST,          // typecasting, not sure if were doing this
-    //Extra
-    AST_NULL,          // null values
-    AST_FACTORIAL      // factorial
-    // TODO: Add more node types as needed
-} ASTNodeType;
+#include "source.h"
+#include "lexer.h"
+#include "ast.h"
+#include "diagnostics.h"
 
 typedef enum {
     PARSE_ERROR_NONE,
@@ -53,20 +26,61 @@ typedef enum {
     PARSE_ERROR_INVALID_CONDITION,
 } ParseError;
 
+// Syntax error found while parsing, only formatted when printed so recording one stays cheap
+typedef struct {
+    uint8_t error;              // ParseError
+    uint8_t expected;           // TokenType that was expected, for PARSE_ERROR_MISSING_PAREN
+    uint32_t token;             // Index of the token the error was found at
+} ParseDiagnostic;
 
-
-// AST Node structure
-typedef struct ASTNode {
-    ASTNodeType type;           // Type of node
-    Token token;               // Token associated with this node
-    struct ASTNode* left;      // Left child
-    struct ASTNode* right;     // Right child
-} ASTNode;
+// Parser context for one input, walks a token buffer from lex_all so parsers never share anything
+typedef struct {
+    TokenBuffer* tokens;
+    size_t index;               // Current token being processed
+    Ast ast;                    // Owns every node of the trees it parses
+    NodeId* statements;         // Statements of the open sequences, innermost last, moved to the Ast when one closes
+    size_t statement_count;
+    size_t statement_capacity;
+    ParseDiagnostic* diagnostics;   // Syntax errors in source order
+    size_t diagnostic_count;
+    size_t diagnostic_capacity;
+    int panic;                  // Set by a syntax error until the parser resynchronizes, errors are not recorded meanwhile
+    int loops;                  // While and repeat bodies around the statement being parsed, a break needs one
+    struct ParseFrame* frames;  // Pending productions of parse_iterative, kept for the next parse
+    size_t frame_capacity;
+    struct ParseWorkers* workers;   // Worker parsers of parse_parallel, kept for the next parse
+    size_t stale;               // Nodes and statement slots parse_edit left unreachable
+    struct ConsTable* cons;     // Expression nodes by content while hash-consing, NULL otherwise
+} ParserState;
 
 // Parser functions
-void parser_init(const char* input);
-ASTNode* parse(void);
-void print_ast(ASTNode* node, int level);
-void free_ast(ASTNode* node);
+void parser_init(ParserState* parser, TokenBuffer* tokens);
+// Parse the whole buffer into parser->ast, returns the root node
+// Syntax errors do not stop the parse: each is recorded in parser->diagnostics, the statement it was found
+// in becomes an AST_ERROR node and parsing resumes at the next `;`, `}` or statement keyword
+NodeId parse(ParserState* parser);
+// Same tree and errors as parse, but pending productions are kept on a heap stack instead of the C stack,
+// so nesting depth is only bounded by memory. Use it for machine-generated or untrusted input
+NodeId parse_iterative(ParserState* parser);
+// Same tree and errors as parse, with the top level statements split into up to `threads` chunks at `;` and `}`
+// outside braces and each chunk parsed on its own thread. Small buffers, and any buffer while hash-consing, are
+// parsed on the calling thread
+NodeId parse_parallel(ParserState* parser, int threads);
+// Brings the tree of root up to date after lex_edit changed the tokens as edit says, only the statements of the
+// innermost block holding the edit are parsed again and every other subtree is kept, though every node past the
+// edit still has its token index moved. The tree and errors are the ones parse gives for the new tokens, but nodes
+// are numbered differently. Returns the root, which is a new one when the edits left too many unreachable nodes
+// and the whole buffer was parsed again
+NodeId parse_edit(ParserState* parser, NodeId root, const TokenEdit* edit);
+// Share one node between equal expressions (same operators, operands, literals and names that see the same
+// declarations) in every later parse, so trees become DAGs. Off by default. Parse errors about a shared node name
+// where it first appeared, the checker reports every use at its statement instead. parse_parallel and parse_edit
+// parse the whole buffer on one thread, since a shared node has no single chunk or place
+void parser_set_hash_consing(ParserState* parser, int enabled);
+// Format every recorded syntax error into sink, in source order
+void report_parse_errors(const ParserState* parser, DiagSink* sink);
+void parser_reset(ParserState* parser);
+void parser_free(ParserState* parser);
+void print_ast(const Ast* ast, NodeId node, int level);
 
 #endif /* PARSER_H */
\ No newline at end of file
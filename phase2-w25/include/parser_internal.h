@@ -0,0 +1,138 @@
+/* parser_internal.h */
+#ifndef PARSER_INTERNAL_H
+#define PARSER_INTERNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "parser.h"
+
+/* Helpers shared by the recursive parser (parser.c), the explicit-stack one (parser_iter.c) and the
+ * parallel driver (parser_parallel.c). All of them build the same tree with the same node order and
+ * report the same errors. */
+
+/* Binary operators by token type, an operator binds tighter the higher its precedence. Types without
+ * an entry have precedence 0 and end the expression, which includes % since it has no binary form yet. */
+typedef struct {
+    uint8_t precedence;
+    uint8_t right_associative;
+} OperatorInfo;
+
+extern const OperatorInfo parser_binary_operators[TOKEN_TYPE_COUNT];
+
+// Record a syntax error at the current token and enter panic mode, nothing is recorded while in panic mode
+void parser_record_error(ParserState *parser, ParseError error, TokenType expected);
+// Keep a statement that failed to parse as an AST_ERROR node over what was parsed of it, and resynchronize
+NodeId parser_recover_statement(ParserState *parser, NodeId statement, size_t start);
+// Parse variable declaration: e.g. int x;
+NodeId parse_declaration(ParserState *parser);
+// Queue top level statements from the current token until one ends at or past token end, or at the end of input
+void parse_top_level(ParserState *parser, size_t end);
+// Release the worker parsers parse_parallel keeps in parser
+void parse_workers_free(ParserState *parser);
+// Hash-consing (parser_cons.c), only called while parser->cons is set
+NodeId parser_cons_node(ParserState *parser, NodeId node);
+void parser_cons_enter(ParserState *parser);
+void parser_cons_leave(ParserState *parser);
+void parser_cons_declare(ParserState *parser);
+void parser_cons_reset(ParserState *parser);
+
+// Type of the token k places ahead of the current one, TOKEN_EOF past the end
+static inline TokenType peek(ParserState *parser, size_t k) {
+    size_t last = parser->tokens->count - 1;
+    return (TokenType)parser->tokens->types[parser->index + k < last ? parser->index + k : last];
+}
+
+// Match current token with expected type
+static inline int match(ParserState *parser, TokenType type) {
+    return peek(parser, 0) == type;
+}
+
+// Get next token, stays on TOKEN_EOF at the end
+static inline void advance(ParserState *parser) {
+    if (parser->index + 1 < parser->tokens->count) parser->index++;
+}
+
+static inline void parse_error(ParserState *parser, ParseError error) {
+    parser_record_error(parser, error, TOKEN_EOF);
+}
+
+// Expect a token type or error
+// Globally advances on success, stays on the unexpected token otherwise
+static inline void expect(ParserState *parser, TokenType type) {
+    if (match(parser, type)) {
+        advance(parser);
+    } else if (type == TOKEN_SEMICOLON) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+    } else {
+        parser_record_error(parser, PARSE_ERROR_MISSING_PAREN, type);
+    }
+}
+
+// Create a new AST node for the token at index
+static inline NodeId create_node_at(ParserState *parser, ASTNodeType type, size_t index) {
+    NodeId node = ast_add(&parser->ast, type, index);
+    if (node == NODE_NONE) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+    return node;
+}
+
+// Create a new AST node for the current token
+static inline NodeId create_node(ParserState *parser, ASTNodeType type) {
+    return create_node_at(parser, type, parser->index);
+}
+
+// Node equal to the expression node just added, which is dropped when one already exists
+static inline NodeId cons_node(ParserState *parser, NodeId node) {
+    return parser->cons ? parser_cons_node(parser, node) : node;
+}
+
+// Scope ids of hash-consed names: a block opens or closes, a declaration may shadow a name
+static inline void cons_enter_block(ParserState *parser) {
+    if (parser->cons) parser_cons_enter(parser);
+}
+
+static inline void cons_leave_block(ParserState *parser) {
+    if (parser->cons) parser_cons_leave(parser);
+}
+
+static inline void cons_declare(ParserState *parser) {
+    if (parser->cons) parser_cons_declare(parser);
+}
+
+// Set a child, the child is parsed before the arrays are indexed since parsing it can move them
+static inline void set_left(ParserState *parser, NodeId node, NodeId child) {
+    parser->ast.left[node] = child;
+}
+
+static inline void set_right(ParserState *parser, NodeId node, NodeId child) {
+    parser->ast.right[node] = child;
+}
+
+// Queue a statement of the innermost open sequence
+static inline void push_statement(ParserState *parser, NodeId statement) {
+    if (parser->statement_count == parser->statement_capacity) {
+        size_t capacity = parser->statement_capacity ? parser->statement_capacity * 2 : 64;
+        NodeId *statements = realloc(parser->statements, capacity * sizeof(NodeId));
+        if (!statements) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+        parser->statements = statements;
+        parser->statement_capacity = capacity;
+    }
+    parser->statements[parser->statement_count++] = statement;
+}
+
+// Close a sequence, the statements queued since first become its children
+static inline void end_sequence(ParserState *parser, NodeId sequence, size_t first) {
+    if (!ast_set_children(&parser->ast, sequence, parser->statements + first, parser->statement_count - first)) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+    parser->statement_count = first;
+}
+
+#endif /* PARSER_INTERNAL_H */
@@ -0,0 +1,58 @@
+/* resolve.h */
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+#include "ast.h"
+
+/* Name resolution
+ * One pass over a tree that binds every name to the declaration it means, with the scoping rules of the
+ * semantic checker: a block, and the body of an if, else, while or repeat, is a scope, and a declaration is
+ * seen from the statement after it to the end of its scope. Each declaration gets a dense SymbolId in
+ * declaration order and a frame slot. Slots are handed out like a stack, so a slot is reused once the scope
+ * it was given in is left, and frame_size slots hold every variable of the program.
+ * The result is a side table indexed by NodeId, so read-only trees (mapped caches, hash-consed DAGs) can be
+ * resolved as well. A shared node of a hash-consed tree always sees the same declarations, so every use of
+ * it resolves to the same symbol. Later passes index arrays by SymbolId instead of looking names up. */
+
+typedef uint32_t SymbolId;
+#define SYMBOL_NONE UINT32_MAX      // Node is not a name, or names nothing in scope
+
+typedef struct {
+    Atom name;
+    NodeId declaration;         // The AST_INT or AST_STRINGCHAR statement
+    uint8_t type;               // ASTNodeType of the declaration
+    uint32_t scope_level;       // Nesting depth of the scope it was declared in, 0 for the program
+    uint32_t slot;              // Frame slot
+} SymbolInfo;
+
+typedef struct {
+    const Ast* ast;
+    SymbolId* node_symbols;     // Symbol of every declaration and identifier node, SYMBOL_NONE for the rest
+    size_t node_count;
+    SymbolInfo* symbols;        // Indexed by SymbolId
+    size_t symbol_count;
+    size_t symbol_capacity;
+    uint32_t frame_size;        // Slots in use at most at once
+    size_t unresolved;          // Identifiers naming nothing in scope
+    size_t redeclared;          // Declarations of a name already declared in the same scope, they get no symbol
+} Resolution;
+
+// Resolve every name of the tree at root, returns 1 on success and 0 when out of memory
+int resolve_names(Resolution* resolution, const Ast* ast, NodeId root);
+void resolution_free(Resolution* resolution);
+
+// Symbol a declaration or identifier node stands for, SYMBOL_NONE if none
+static inline SymbolId node_symbol(const Resolution* resolution, NodeId node) {
+    return resolution->node_symbols[node];
+}
+
+// Symbol a declaration or identifier node stands for, NULL if none
+static inline const SymbolInfo* node_symbol_info(const Resolution* resolution, NodeId node) {
+    SymbolId id = resolution->node_symbols[node];
+    return id == SYMBOL_NONE ? NULL : &resolution->symbols[id];
+}
+
+#endif /* RESOLVE_H */
@@ -0,0 +1,38 @@
+/* scan.h */
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bulk scanning kernels used by the lexer.
+ * Every kernel takes the NUL-terminated input and a start offset and returns the offset of the
+ * first byte that ends the run. Newlines are not counted, lines come from the source line index. */
+
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+} ScanLevel;
+
+// Skips spaces, tabs, newlines and the \r of \r\n line endings
+extern size_t (*scan_whitespace)(const char* input, size_t pos);
+// Finds the '\n' (or end of input) that ends a # comment
+extern size_t (*scan_line_end)(const char* input, size_t pos);
+// Finds the "*/" (or end of input) that closes a /* comment, returns the offset of the '*'
+extern size_t (*scan_comment_end)(const char* input, size_t pos);
+// Finds the first byte that is not a letter, digit or '_'
+extern size_t (*scan_identifier)(const char* input, size_t pos);
+// Finds the next '"', '\' or end of input inside a string literal
+extern size_t (*scan_string)(const char* input, size_t pos);
+// Marks the bytes that can open or close a string, char literal or comment ('\n' " ' # / * \ and NUL)
+// from pos up to the next 64-byte boundary, bit i standing for pos + i. Bits past the NUL are unspecified
+extern uint64_t (*scan_structural_mask)(const char* input, size_t pos);
+
+// Kernels are picked through CPUID at load time, scan_select forces a level (capped to what the CPU supports)
+// and must be called before any thread starts lexing
+ScanLevel scan_select(ScanLevel level);
+ScanLevel scan_level(void);
+const char* scan_level_name(ScanLevel level);
+
+#endif /* SCAN_H */
@@ -3,7 +3,16 @@
 #ifndef SEMANTIC_H
 #define SEMANTIC_H
 
+#include <stdbool.h>
 #include "tokens.h"
+#include "intern.h"
+#include "source.h"
+#include "parser.h"
+#include "arena.h"
+#include "resolve.h"
+#include "type_table.h"
+#include "dataflow.h"
+#include "diagnostics.h"
 
 typedef enum {
     SEM_ERROR_NONE,
@@ -17,46 +26,80 @@ typedef enum {
 
 // Basic symbol structure
 typedef struct Symbol {
-    char name[100];          // Variable name
+    Atom name;               // Interned variable name
     int type;                // Data type (int, etc.)
     int scope_level;         // Scope nesting level
-    int line_declared;       // Line where declared
-    int is_initialized;      // Has been assigned a value?
-    struct Symbol* next;     // For linked list implementation
+    uint32_t id;             // SymbolId given by resolve_names
+    struct Symbol* next;     // Symbol of the same name this one shadows, NULL if none
 } Symbol;
 
-// Symbol table
+// Name of an open-addressing slot and the innermost visible symbol of it
 typedef struct {
-    Symbol* head;            // First symbol in the table
+    Atom name;               // ATOM_NONE for an empty slot
+    Symbol* symbol;          // NULL once every symbol of the name went out of scope, the slot stays for the name
+} SymbolSlot;
+
+/* Scoped symbol table
+ * Names hash to slots that hold the innermost symbol of each name, and every symbol links to the one it
+ * shadows, so a lookup is one probe whatever the number of symbols or scopes. The live symbols are also
+ * kept in declaration order, which is scope order as well: leaving a scope pops the symbols above it off
+ * the end and puts back the ones they shadowed. Symbols come from a pool in an arena and popped ones are
+ * reused, so declaring a symbol only calls malloc when the pool runs dry. */
+typedef struct {
+    SymbolSlot* slots;
+    size_t slot_count;       // Power of two
+    size_t slot_used;
+    Symbol** symbols;        // Live symbols, oldest first
+    size_t symbol_count;
+    size_t symbol_capacity;
+    Symbol* free_symbols;    // Popped symbols for reuse, linked by next
+    Arena pool;
     int current_scope;       // Current scope level
 } SymbolTable;
 
+/* Checker state
+ * resolve_names is the only pass that looks names up in a SymbolTable. The checks read the symbol of every
+ * declaration and identifier from its Resolution instead, and only keep the symbols in scope, in declaration
+ * order, to trace the table as it grows. */
+typedef struct {
+    const Ast* ast;          // Tree being checked, nodes index into it
+    const Resolution* resolution;   // Symbol of every name
+    const TypeTable* types;  // Types of its expressions
+    const InitAnalysis* initialization; // Uses that may read uninitialized variables
+    NodeId statement;        // Statement being checked, the uses of its expressions are looked up under it
+    DiagSink* diagnostics;   // Where errors are reported, its log level decides whether checks are traced
+    SymbolId* live;          // Symbols in scope, oldest first
+    size_t live_count;
+    size_t live_capacity;
+    int current_scope;       // Current scope level
+} CheckerState;
+
 /* --- SYMBOL TABLE OPERATIONS --- */
-void add_symbol(SymbolTable* table, const char* name, int type, int line);
-Symbol* lookup_symbol(SymbolTable* table, const char* name);
-Symbol* lookup_symbol_current_scope(SymbolTable* table, const char* name);
-void print_symbol_table(SymbolTable* table);
-void print_symbol(Symbol* symbol);
+// Empty table, NULL when out of memory
+SymbolTable* init_symbol_table(void);
+Symbol* add_symbol(SymbolTable* table, Atom name, int type);
+Symbol* lookup_symbol(SymbolTable* table, Atom name);
+Symbol* lookup_symbol_current_scope(SymbolTable* table, Atom name);
 void enter_scope(SymbolTable* table);
 void exit_scope(SymbolTable* table);
 void remove_symbols_in_current_scope(SymbolTable* table);
-void free_symbol(Symbol* symbol);
+void free_symbol(SymbolTable* table, Symbol* symbol);
 void free_symbol_table(SymbolTable* table);
 
 /* --- SEMANTIC ANALYSIS FUNCTIONS --- */
-int analyze_semantics(ASTNode* ast);
-int check_program(ASTNode* node, SymbolTable* table);
-int check_statement(ASTNode* node, SymbolTable* table);
-int check_declaration(ASTNode* node, SymbolTable* table);
-int check_assignment(ASTNode* node, SymbolTable* table);
-bool check_expression(ASTNode* node, SymbolTable* table);
-bool check_string(ASTNode* node, SymbolTable* table);
-int check_block(ASTNode* node, SymbolTable* table);
-int check_print(ASTNode* node, SymbolTable* table);
-int check_condition(ASTNode* node, SymbolTable* table);
-int check_condition(ASTNode* node, SymbolTable* table);
+int analyze_semantics(const Ast* ast, NodeId root, DiagSink* diagnostics);
+int check_program(NodeId node, CheckerState* checker);
+int check_statement(NodeId node, CheckerState* checker);
+int check_declaration(NodeId node, CheckerState* checker);
+int check_assignment(NodeId node, CheckerState* checker);
+bool check_expression(NodeId node, CheckerState* checker);
+bool check_string(NodeId node, CheckerState* checker);
+int check_block(NodeId node, CheckerState* checker);
+int check_print(NodeId node, CheckerState* checker);
+int check_condition(NodeId node, CheckerState* checker);
+int check_condition(NodeId node, CheckerState* checker);
 
 /* --- ERROR REPORTING --- */
-void semantic_error(SemanticErrorType error, const char* name, int line);
+void semantic_error(DiagSink* diagnostics, SemanticErrorType error, Atom name, SourceLocation location);
 
 #endif //SEMANTIC_H
@@ -0,0 +1,41 @@
+/* source.h */
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A loaded source file
+ * data is always NUL-terminated, the lexer relies on that instead of checking length.
+ * Files are memory-mapped read-only when possible so they are never copied before lexing.
+ * Nothing tracks lines while lexing: the offset of every line start is collected in one memchr pass
+ * the first time a location is asked for, and locations are found by binary search over it. */
+typedef struct {
+    const char* data;       // File contents followed by '\0'
+    size_t length;          // Number of bytes before the terminator
+    int mapped;             // 1 if data is a file mapping, 0 if it was allocated
+    struct SourceLines* lines;  // Line start index, NULL until source_location first needs it
+} Source;
+
+// Line and column of a byte, both counted from 1. Columns count bytes
+typedef struct {
+    int line;
+    int column;
+} SourceLocation;
+
+// Load a file, returns 1 on success and 0 on failure
+int source_load(Source* source, const char* path);
+// Copy an in-memory buffer into a source, returns 1 on success and 0 on failure
+int source_from_string(Source* source, const char* text, size_t length);
+// Replace `removed` bytes at offset with length bytes of text, the data is copied out of a mapping first.
+// Drops the line index, returns 1 on success and 0 on failure (the source is left as it was)
+int source_edit(Source* source, size_t offset, size_t removed, const char* text, size_t length);
+// 64-bit hash of the contents, the key of results cached for a source. Not cryptographic
+uint64_t source_hash(const Source* source);
+// Location of the byte at offset, builds the line index on the first call (safe from any thread).
+// Returns 0:0 if the index cannot be allocated
+SourceLocation source_location(const Source* source, size_t offset);
+// Release the mapping or buffer and the line index
+void source_free(Source* source);
+
+#endif /* SOURCE_H */
@@ -3,13 +3,23 @@
 #ifndef TOKENS_H
 #define TOKENS_H
 
+#include <stdint.h>
+
 /* Token types that need to be recognized by the lexer */
 typedef enum {
     TOKEN_EOF,
     TOKEN_NUMBER,           // e.g. 123
-    TOKEN_OPERATOR,         // e.g. + - * / %
-    TOKEN_EQUALS,           // e.g. += -= =
-    TOKEN_COMPARITIVE,      // e.g. == !=
+    // Operators, one type each so the parser dispatches on the type alone
+    // TOKEN_PLUS ... TOKEN_OR and TOKEN_EQUAL_EQUAL ... TOKEN_GREATER_EQUAL are used as case ranges
+    TOKEN_PLUS, TOKEN_MINUS, TOKEN_STAR, TOKEN_SLASH, TOKEN_PERCENT,  // + - * / %
+    TOKEN_POWER,            // ^^
+    TOKEN_NOT,              // !
+    TOKEN_AND, TOKEN_OR,    // && ||
+    TOKEN_EQUALS,           // =
+    // Comparatives
+    TOKEN_EQUAL_EQUAL, TOKEN_NOT_EQUAL,                   // == !=
+    TOKEN_LESS, TOKEN_GREATER,                            // < >
+    TOKEN_LESS_EQUAL, TOKEN_GREATER_EQUAL,                // <= >=
     TOKEN_IF, TOKEN_ELSE,                                 // Conditionals
     TOKEN_WHILE, TOKEN_UNTIL, TOKEN_REPEAT, TOKEN_BREAK,  // Looping
     TOKEN_PRINT,                                          // Output
@@ -25,7 +35,8 @@ typedef enum {
     TOKEN_SEMICOLON,        // e.g. ;
     TOKEN_SPECIAL_CHARACTER,// e.g. _ &
     TOKEN_FACTORIAL,        // e.g. $
-    TOKEN_ERROR             // e.g. ERROR_INVALID_CHAR
+    TOKEN_ERROR,            // e.g. ERROR_INVALID_CHAR
+    TOKEN_TYPE_COUNT
 } TokenType;
 
 /* Error types for lexical analysis */
@@ -38,15 +49,22 @@ typedef enum {
     ERROR_UNTERMINATED_STRING,
     ERROR_INVALID_ESCAPE_CHARACTER,
     ERROR_UNTERMINATED_CHARACTER,
-    ERROR_OPEN_DELIMITER
+    ERROR_OPEN_DELIMITER,
+    ERROR_UNCLOSED_COMMENT          // Set on the TOKEN_EOF of an input that ends inside a comment
 } ErrorType;
 
-/* Token structure to store token information */
+/* Token structure to store token information
+ * A token does not own its text: offset and length are a span of the source buffer it was lexed
+ * from. String and char literals keep their quotes and escapes, use token_decode to get the value.
+ * Tokens carry no line, source_location turns the offset into a line and column when one is needed. */
 typedef struct {
-    TokenType type;
-    char lexeme[100];   // Actual text of the token
-    int line;           // Line number in source file
-    ErrorType error;    // Error type if any
+    uint8_t type;       // TokenType
+    uint8_t error;      // ErrorType, error type if any
+    uint32_t offset;    // Start of the token in the source buffer
+    uint32_t length;    // Number of source bytes the token covers
+    uint32_t reserved;  // Padding to 16 bytes, a power of two that keeps Token arrays aligned
 } Token;
 
+_Static_assert(sizeof(Token) == 16, "Token must stay a 16 byte span");
+
 #endif /* TOKENS_H */
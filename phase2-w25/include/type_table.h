@@ -0,0 +1,48 @@
+/* type_table.h */
+#ifndef TYPE_TABLE_H
+#define TYPE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+#include "resolve.h"
+
+/* Expression types
+ * Every expression node of a tree is given a type once, bottom up, and kept in a side table indexed by
+ * NodeId. Checks and backends read a node's type instead of walking its subtree again:
+ *   numbers are int, string and char literals are string and char, null is null
+ *   a name has the type of the declaration it resolves to (resolve.h), error when it names nothing
+ *   !, $( ) and the binary operators take int operands and give int, anything else gives error
+ * Each node is typed once however many parents share it, so hash-consed DAGs and mapped caches work as is. */
+
+typedef enum {
+    TYPE_NONE,          // Not an expression (statements, sequences)
+    TYPE_INT,
+    TYPE_CHAR,
+    TYPE_STRING,
+    TYPE_NULL,
+    TYPE_ERROR          // Ill-typed, or names something undeclared
+} ValueType;
+
+typedef struct {
+    uint8_t* types;     // ValueType of every node
+    size_t count;
+} TypeTable;
+
+// Type every expression node of the resolved tree, returns 1 on success and 0 when out of memory
+int infer_types(TypeTable* table, const Resolution* resolution);
+void type_table_free(TypeTable* table);
+// Type a declaration gives its variable: int, or char or string by the keyword before the name
+ValueType declared_type(const Ast* ast, NodeId declaration);
+const char* type_name(ValueType type);
+
+static inline ValueType node_type(const TypeTable* table, NodeId node) {
+    return (ValueType)table->types[node];
+}
+
+// String and char values can be assigned to string and char variables alike
+static inline int is_text_type(ValueType type) {
+    return type == TYPE_STRING || type == TYPE_CHAR;
+}
+
+#endif /* TYPE_TABLE_H */
@@ -0,0 +1,83 @@
+/* arena.c */
+#include <stdlib.h>
+#include <stddef.h>
+#include "../../include/arena.h"
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+#define ARENA_MIN_BLOCK 4096
+#define ARENA_MAX_BLOCK ((size_t)16 << 20)  // Stop doubling here, blocks past it cost one malloc per 16MB
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;                // Usable bytes after the header
+    _Alignas(max_align_t) char data[];
+};
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+    arena->block_size = block_size < ARENA_MIN_BLOCK ? ARENA_MIN_BLOCK : block_size;
+    arena->allocations = 0;
+    arena->mallocs = 0;
+}
+
+static void arena_enter(Arena* arena, ArenaBlock* block) {
+    arena->current = block;
+    arena->next = block->data;
+    arena->end = block->data + block->size;
+}
+
+// Move to the next block of the chain that can hold size bytes, allocating one if there is none
+static int arena_grow(Arena* arena, size_t size) {
+    ArenaBlock* block = arena->current ? arena->current->next : arena->first;
+    while (block && block->size < size) block = block->next;
+    if (!block) {
+        size_t capacity = arena->block_size;
+        while (capacity < size) capacity *= 2;
+        block = malloc(sizeof(ArenaBlock) + capacity);
+        if (!block) return 0;
+        block->size = capacity;
+        block->next = NULL;
+        arena->mallocs++;
+        if (arena->block_size < ARENA_MAX_BLOCK) arena->block_size *= 2;
+
+        // Append to the chain so resets walk the blocks in the order they were first filled
+        if (!arena->first) {
+            arena->first = block;
+        } else {
+            ArenaBlock* last = arena->current ? arena->current : arena->first;
+            while (last->next) last = last->next;
+            last->next = block;
+        }
+    }
+    arena_enter(arena, block);
+    return 1;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if ((size_t)(arena->end - arena->next) < size && !arena_grow(arena, size)) return NULL;
+    void* memory = arena->next;
+    arena->next += size;
+    arena->allocations++;
+    return memory;
+}
+
+void arena_reset(Arena* arena) {
+    arena->allocations = 0;
+    if (arena->first) {
+        arena_enter(arena, arena->first);
+    }
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->first;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena_init(arena, ARENA_MIN_BLOCK);
+}
@@ -0,0 +1,149 @@
+/* diagnostics.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "../../include/diagnostics.h"
+
+__attribute__((cold, noinline))
+static void diagnostics_out_of_memory(void) {
+    printf("Memory allocation failed.\n");
+    exit(1);
+}
+
+void diag_init(DiagSink* sink, LogLevel level) {
+    sink->items = NULL;
+    sink->count = 0;
+    sink->capacity = 0;
+    sink->text = NULL;
+    sink->text_length = 0;
+    sink->text_capacity = 0;
+    sink->errors = 0;
+    sink->level = level;
+}
+
+// Make room for length more bytes of text
+static void reserve_text(DiagSink* sink, size_t length) {
+    if (sink->text_length + length <= sink->text_capacity) return;
+    size_t capacity = sink->text_capacity ? sink->text_capacity : 256;
+    while (capacity < sink->text_length + length) capacity *= 2;
+    char* text = realloc(sink->text, capacity);
+    if (!text) diagnostics_out_of_memory();
+    sink->text = text;
+    sink->text_capacity = capacity;
+}
+
+void diag_report(DiagSink* sink, DiagSeverity severity, DiagPhase phase, int code, SourceLocation location,
+                 const char* format, ...) {
+    if (sink->count == sink->capacity) {
+        size_t capacity = sink->capacity ? sink->capacity * 2 : 16;
+        Diagnostic* items = realloc(sink->items, capacity * sizeof(Diagnostic));
+        if (!items) diagnostics_out_of_memory();
+        sink->items = items;
+        sink->capacity = capacity;
+    }
+    // Measured first, so a message is never cut short
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) length = 0;
+    reserve_text(sink, (size_t)length + 1);
+    va_start(args, format);
+    vsnprintf(sink->text + sink->text_length, (size_t)length + 1, format, args);
+    va_end(args);
+
+    Diagnostic* diagnostic = &sink->items[sink->count++];
+    diagnostic->severity = (uint8_t)severity;
+    diagnostic->phase = (uint8_t)phase;
+    diagnostic->code = (uint16_t)code;
+    diagnostic->location = location;
+    diagnostic->message = (uint32_t)sink->text_length;
+    sink->text_length += (size_t)length + 1;
+    if (severity == DIAG_ERROR) sink->errors++;
+}
+
+static int emitted(const DiagSink* sink, const Diagnostic* diagnostic) {
+    return diagnostic->severity == DIAG_ERROR || sink->level >= LOG_WARNING;
+}
+
+// Error codes read as the phase's letter and the error's number, P04 for PARSE_ERROR_MISSING_SEMICOLON
+static const char phase_letters[] = {'L', 'P', 'S'};
+static const char* phase_names[] = {"lexical", "syntax", "semantic"};
+
+static void emit_text(const Diagnostic* diagnostic, const char* message, FILE* out) {
+    int line = diagnostic->location.line, column = diagnostic->location.column;
+    const char* severity = diagnostic->severity == DIAG_ERROR ? "Error" : "Warning";
+    switch ((DiagPhase)diagnostic->phase) {
+        case DIAG_LEXICAL:
+            fprintf(out, "Lexical %s at %d:%d: %s\n", severity, line, column, message);
+            break;
+        case DIAG_SYNTAX:
+            fprintf(out, "Parse %s at %d:%d: %s\n", severity, line, column, message);
+            break;
+        default:
+            // Semantic errors keep their bare format, warnings are marked
+            if (diagnostic->severity == DIAG_ERROR) {
+                fprintf(out, "%s at %d:%d\n", message, line, column);
+            } else {
+                fprintf(out, "Warning: %s at %d:%d\n", message, line, column);
+            }
+    }
+}
+
+// Message as a JSON string, quotes, backslashes and control characters escaped
+static void emit_json_string(const char* text, FILE* out) {
+    fputc('"', out);
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        switch (*c) {
+            case '"': fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (*c < 0x20) {
+                    fprintf(out, "\\u%04x", *c);
+                } else {
+                    fputc(*c, out);
+                }
+        }
+    }
+    fputc('"', out);
+}
+
+static void emit_json(const Diagnostic* diagnostic, const char* message, FILE* out) {
+    fprintf(out, "{\"severity\": \"%s\", \"phase\": \"%s\", \"code\": \"%c%02u\", \"line\": %d, \"column\": %d, \"message\": ",
+            diagnostic->severity == DIAG_ERROR ? "error" : "warning", phase_names[diagnostic->phase],
+            phase_letters[diagnostic->phase], diagnostic->code, diagnostic->location.line, diagnostic->location.column);
+    emit_json_string(message, out);
+    fputc('}', out);
+}
+
+void diag_emit(const DiagSink* sink, FILE* out, DiagFormat format) {
+    int first = 1;
+    if (format == DIAG_JSON) fputc('[', out);
+    for (size_t i = 0; i < sink->count; i++) {
+        const Diagnostic* diagnostic = &sink->items[i];
+        if (!emitted(sink, diagnostic)) continue;
+        if (format == DIAG_JSON) {
+            fputs(first ? "\n  " : ",\n  ", out);
+            emit_json(diagnostic, diag_message(sink, diagnostic), out);
+        } else {
+            emit_text(diagnostic, diag_message(sink, diagnostic), out);
+        }
+        first = 0;
+    }
+    if (format == DIAG_JSON) fputs(first ? "]\n" : "\n]\n", out);
+}
+
+void diag_clear(DiagSink* sink) {
+    sink->count = 0;
+    sink->text_length = 0;
+    sink->errors = 0;
+}
+
+void diag_free(DiagSink* sink) {
+    free(sink->items);
+    free(sink->text);
+    diag_init(sink, sink->level);
+}
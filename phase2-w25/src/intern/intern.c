@@ -0,0 +1,184 @@
+/* intern.c */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../../include/intern.h"
+
+/* An atom is (entry number + 1) << SHARD_BITS | shard, so 0 is never an atom and the shard of an
+ * atom is in its low bits. The top bits of the hash pick the shard and the low bits the slot.
+ * Entries live in segments that never move once allocated (segment k holds 256 << k entries),
+ * which lets atom_text read them without the lock: whoever holds an atom got it from intern, and
+ * the entry was written under the shard lock before the atom was handed out. */
+
+#define SHARD_BITS 6
+#define SHARD_COUNT (1 << SHARD_BITS)
+#define SEGMENT_BASE_BITS 8
+#define SEGMENT_COUNT (32 - SHARD_BITS - SEGMENT_BASE_BITS + 1)
+#define MAX_ENTRIES ((1u << (32 - SHARD_BITS)) - 1)
+#define INITIAL_SLOTS 256
+#define ARENA_BLOCK (64 * 1024)
+
+typedef struct {
+    const char* text;       // NUL-terminated copy in the shard arena
+    uint32_t length;
+    uint32_t hash;
+} InternEntry;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t id;            // Entry number + 1, 0 for an empty slot
+} InternSlot;
+
+typedef struct {
+    pthread_mutex_t lock;
+    InternSlot* slots;      // Open addressing, linear probing, at most half full
+    uint32_t mask;          // Slot count - 1
+    uint32_t count;         // Entries in the shard
+    InternEntry* segments[SEGMENT_COUNT];
+    char* arena;            // Free space in the current string block
+    size_t arena_left;
+} InternShard;
+
+static InternShard shards[SHARD_COUNT] = {[0 ... SHARD_COUNT - 1] = {.lock = PTHREAD_MUTEX_INITIALIZER}};
+
+// FNV-1a
+static uint32_t hash_bytes(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Entry n of a shard, segment k covers entries [(256 << k) - 256, (256 << (k + 1)) - 256)
+static InternEntry* entry_at(const InternShard* shard, uint32_t n) {
+    uint32_t biased = n + (1u << SEGMENT_BASE_BITS);
+    int top = 31 - __builtin_clz(biased);
+    return &shard->segments[top - SEGMENT_BASE_BITS][biased - (1u << top)];
+}
+
+// Copy text into the shard arena, long strings get a block of their own
+static const char* arena_copy(InternShard* shard, const char* text, size_t length) {
+    char* copy;
+    if (length + 1 > ARENA_BLOCK / 4) {
+        copy = malloc(length + 1);
+        if (!copy) return NULL;
+    } else {
+        if (length + 1 > shard->arena_left) {
+            char* block = malloc(ARENA_BLOCK);
+            if (!block) return NULL;
+            shard->arena = block;
+            shard->arena_left = ARENA_BLOCK;
+        }
+        copy = shard->arena;
+        shard->arena += length + 1;
+        shard->arena_left -= length + 1;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Double the slot table, or create it
+static int grow_slots(InternShard* shard) {
+    uint32_t capacity = shard->slots ? (shard->mask + 1) * 2 : INITIAL_SLOTS;
+    InternSlot* slots = calloc(capacity, sizeof(InternSlot));
+    if (!slots) return 0;
+    if (shard->slots) {
+        for (uint32_t i = 0; i <= shard->mask; i++) {
+            if (!shard->slots[i].id) continue;
+            uint32_t j = shard->slots[i].hash & (capacity - 1);
+            while (slots[j].id) j = (j + 1) & (capacity - 1);
+            slots[j] = shard->slots[i];
+        }
+        free(shard->slots);
+    }
+    shard->slots = slots;
+    shard->mask = capacity - 1;
+    return 1;
+}
+
+// Append an entry, returns its id or 0
+static uint32_t add_entry(InternShard* shard, const char* text, size_t length, uint32_t hash) {
+    if (shard->count >= MAX_ENTRIES) return 0;
+    uint32_t n = shard->count;
+    int segment = 31 - __builtin_clz(n + (1u << SEGMENT_BASE_BITS)) - SEGMENT_BASE_BITS;
+    if (!shard->segments[segment]) {
+        shard->segments[segment] = malloc(((size_t)1 << (SEGMENT_BASE_BITS + segment)) * sizeof(InternEntry));
+        if (!shard->segments[segment]) return 0;
+    }
+    const char* copy = arena_copy(shard, text, length);
+    if (!copy) return 0;
+    InternEntry* entry = entry_at(shard, n);
+    entry->text = copy;
+    entry->length = (uint32_t)length;
+    entry->hash = hash;
+    shard->count++;
+    return n + 1;
+}
+
+Atom intern(const char* text, size_t length) {
+    return intern_hashed(text, length, hash_bytes(text, length));
+}
+
+Atom intern_hashed(const char* text, size_t length, uint32_t hash) {
+    if (length > UINT32_MAX) return ATOM_NONE;
+    uint32_t index = hash >> (32 - SHARD_BITS);
+    InternShard* shard = &shards[index];
+    uint32_t id = 0;
+
+    pthread_mutex_lock(&shard->lock);
+    if (shard->slots || grow_slots(shard)) {
+        uint32_t i = hash & shard->mask;
+        while (shard->slots[i].id) {
+            if (shard->slots[i].hash == hash) {
+                const InternEntry* entry = entry_at(shard, shard->slots[i].id - 1);
+                if (entry->length == length && memcmp(entry->text, text, length) == 0) {
+                    id = shard->slots[i].id;
+                    break;
+                }
+            }
+            i = (i + 1) & shard->mask;
+        }
+        if (!id) {
+            id = add_entry(shard, text, length, hash);
+            if (id) {
+                shard->slots[i].hash = hash;
+                shard->slots[i].id = id;
+                // Keep the table at most half full, a failed grow only makes probes longer
+                if (shard->count * 2 > shard->mask + 1) grow_slots(shard);
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return id ? id << SHARD_BITS | index : ATOM_NONE;
+}
+
+uint32_t intern_hash(const char* text, size_t length) {
+    return hash_bytes(text, length);
+}
+
+Atom intern_cstr(const char* text) {
+    return intern(text, strlen(text));
+}
+
+const char* atom_text(Atom atom) {
+    if (atom == ATOM_NONE) return "";
+    return entry_at(&shards[atom & (SHARD_COUNT - 1)], (atom >> SHARD_BITS) - 1)->text;
+}
+
+size_t atom_length(Atom atom) {
+    if (atom == ATOM_NONE) return 0;
+    return entry_at(&shards[atom & (SHARD_COUNT - 1)], (atom >> SHARD_BITS) - 1)->length;
+}
+
+size_t intern_count(void) {
+    size_t count = 0;
+    for (int i = 0; i < SHARD_COUNT; i++) {
+        pthread_mutex_lock(&shards[i].lock);
+        count += shards[i].count;
+        pthread_mutex_unlock(&shards[i].lock);
+    }
+    return count;
+}
@@ -2,14 +2,14 @@
 /* lexer.c */
 #include <stdio.h>
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 #include "../../include/tokens.h"
+#include "../../include/lexer.h"
+#include "../../include/scan.h"
 
-// Line tracking
-static int current_line = 1;
-static char last_token_type = 'y'; // For checking consecutive operators
-
-// Keyword Table
+#ifndef LEXER_DFA
+// Keyword Table (the DFA engine uses the perfect hash in lexer_dfa.c instead)
 static struct {
     const char* word;
     TokenType type;
@@ -28,50 +28,139 @@ static struct {
 };
 
 // New Keyword Checker
-static int IsKeyword(const char* word) {
+static int IsKeyword(const char* word, int length) {
     for (int i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
-        if (strcmp(word, keywords[i].word) == 0) {
+        if (strncmp(word, keywords[i].word, length) == 0 && keywords[i].word[length] == '\0') {
             return keywords[i].type;
         }
     }
     return 0;
 }
+#endif /* LEXER_DFA */
 
-/* Print error messages for lexical errors */
-void print_error(ErrorType error, int line, const char *lexeme) {
-    printf("Lexical Error at line %d: ", line);
+/* Error messages for lexical errors */
+// printf format of the message for error, only ERROR_INVALID_CHAR reads the lexeme ("%.*s")
+static const char* lexical_error_format(ErrorType error) {
     switch (error) {
         case ERROR_INVALID_CHAR:
-            printf("Invalid character '%s'\n", lexeme);
-            break;
+            return "Invalid character '%.*s'";
         case ERROR_INVALID_NUMBER:
-            printf("Invalid number format\n");
-            break;
+            return "Invalid number format";
         case ERROR_CONSECUTIVE_OPERATORS:
-            printf("Consecutive operators not allowed\n");
-            break;
+            return "Consecutive operators not allowed";
         case ERROR_STRING_OVERFLOW:
-            printf("Overflow in string\n");
-            break;
+            return "Overflow in string";
         case ERROR_UNTERMINATED_STRING:
-            printf("Unterminated string\n");
-            break;
+            return "Unterminated string";
         case ERROR_INVALID_ESCAPE_CHARACTER:
-            printf("Unrecognized/invalid escape character\n");
-            break;
+            return "Unrecognized/invalid escape character";
         case ERROR_UNTERMINATED_CHARACTER:
-            printf("Unterminated character\n");
-            break;
+            return "Unterminated character";
+        case ERROR_UNCLOSED_COMMENT:
+            return "Unclosed comment";
         default:
-            printf("Unknown error\n");
+            return "Unknown error";
+    }
+}
+
+void print_error(ErrorType error, SourceLocation location, const char *lexeme, int length) {
+    printf("Lexical Error at %d:%d: ", location.line, location.column);
+    printf(lexical_error_format(error), length, lexeme);
+    printf("\n");
+}
+
+void report_lexical_errors(const TokenBuffer *buffer, DiagSink *sink) {
+    for (size_t i = 0; i < buffer->count; i++) {
+        ErrorType error = (ErrorType)buffer->errors[i];
+        if (error == ERROR_NONE) continue;
+        DiagSeverity severity = error == ERROR_UNCLOSED_COMMENT ? DIAG_WARNING : DIAG_ERROR;
+        diag_report(sink, severity, DIAG_LEXICAL, error, token_location(buffer, i), lexical_error_format(error),
+                    (int)buffer->lengths[i], buffer->source->data + buffer->offsets[i]);
+    }
+}
+
+/* Token text helpers */
+// Value of an escape character, 0 if it is not supported
+static char escape_value(char c) {
+    switch (c) {
+        case '\\':
+        case '\'':
+        case '\"':
+            return c;
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        default:
+            return 0;
+    }
+}
+
+int token_equals(const char *source, Token token, const char *text) {
+    return strncmp(source + token.offset, text, token.length) == 0 && text[token.length] == '\0';
+}
+
+int token_decode(const char *source, Token token, char *out, int capacity) {
+    const char *text = source + token.offset;
+    int literal = token.type == TOKEN_STRING_LITERAL || token.type == TOKEN_CHAR_LITERAL;
+    int i = 0;
+    int end = token.length;
+    int length = 0;
+    if (literal) {
+        // drop the quotes, only well formed literals get these token types
+        i = 1;
+        end--;
+    }
+    while (i < end) {
+        char c = text[i++];
+        if (literal && c == '\\' && i < end && escape_value(text[i])) {
+            c = escape_value(text[i++]);
+        }
+        if (length < capacity - 1) {
+            out[length] = c;
+        }
+        length++;
+    }
+    out[length < capacity - 1 ? length : capacity - 1] = '\0';
+    return length;
+}
+
+// Prints a token the way it reads in messages: literal values decoded, strings kept in quotes
+void print_token_text(const char *source, Token token) {
+    if (token.type == TOKEN_EOF) {
+        printf("EOF");
+        return;
+    }
+    if (token.type != TOKEN_STRING_LITERAL && token.type != TOKEN_CHAR_LITERAL) {
+        printf("%.*s", (int)token.length, source + token.offset);
+        return;
+    }
+    char small[128];
+    char *value = small;
+    int length = token_decode(source, token, small, sizeof(small));
+    if (length >= (int)sizeof(small)) {
+        value = malloc(length + 1);
+        if (!value) return;
+        token_decode(source, token, value, length + 1);
+    }
+    if (token.type == TOKEN_STRING_LITERAL) {
+        printf("\"%.*s\"", length, value);
+    } else {
+        printf("%.*s", length, value);
+    }
+    if (value != small) {
+        free(value);
     }
 }
 
 /* Print token information */
-void print_token(Token token) {
+void print_token(const Source *source, Token token) {
+    SourceLocation location = source_location(source, token.offset);
     if (token.error != ERROR_NONE) {
-        print_error(token.error, token.line, token.lexeme);
-        return;
+        print_error(token.error, location, source->data + token.offset, token.length);
+        if (token.type != TOKEN_EOF) return; // An unclosed comment still ends in the EOF token
     }
 
     printf("Token: ");
@@ -79,7 +168,7 @@ void print_token(Token token) {
         case TOKEN_NUMBER:
             printf("NUMBER");
             break;
-        case TOKEN_OPERATOR:
+        case TOKEN_PLUS ... TOKEN_OR:
             printf("OPERATOR");
             break;
         case TOKEN_EOF:
@@ -125,7 +214,7 @@ void print_token(Token token) {
         case TOKEN_EQUALS:
             printf("EQUALS");
             break;
-        case TOKEN_COMPARITIVE:
+        case TOKEN_EQUAL_EQUAL ... TOKEN_GREATER_EQUAL:
             printf("COMPARATIVE SYMBOL");
             break;
         case TOKEN_FACTORIAL:
@@ -134,207 +223,135 @@ void print_token(Token token) {
         default:
             printf("UNKNOWN");
     }
-    printf(" | Lexeme: '%s' | Line: %d\n", token.lexeme, token.line);
+    printf(" | Lexeme: '");
+    print_token_text(source->data, token);
+    printf("' | Line: %d:%d\n", location.line, location.column);
 }
 
-/* Get next token from input */
-Token get_next_token(const char *input, int *pos) {
-    Token token = {TOKEN_ERROR, "", current_line, ERROR_NONE};
+#ifndef LEXER_DFA
+/* Hand-written scanner, the reference path for the table-driven engine in lexer_dfa.c */
+static Token hand_next_token(LexerState *lexer) {
+    const char *input = lexer->source->data;
+    int *pos = &lexer->pos;
+    Token token = {.type = TOKEN_ERROR, .error = ERROR_NONE};
     char c;
 
-    // Skip whitespace and track line numbers
-    while ((c = input[*pos]) != '\0' && (c == ' ' || c == '\n' || c == '\t')) {
-        if (c == '\n') {
-            current_line++;
+    // Skip whitespace and comments
+    while (1) {
+        c = input[*pos];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            *pos = (int)scan_whitespace(input, *pos);
+        } else if (c == '#') {
+            // Single line comment, newline is left for the whitespace case
+            *pos = (int)scan_line_end(input, *pos);
+        } else if (c == '/' && input[*pos + 1] == '*') {
+            // Multi line comment, should skip until */ is reached
+            *pos = (int)scan_comment_end(input, *pos + 2);
+            if (input[*pos] == '\0') {
+                lexer->unclosed_comment = 1;
+            } else {
+                (*pos) += 2; // move ahead of */
+            }
+        } else {
+            break;
         }
-        (*pos)++;
     }
+    token.offset = *pos;
 
     // Check for end of file
-    if (input[*pos] == '\0') {
+    if (c == '\0') {
         token.type = TOKEN_EOF;
-        strcpy(token.lexeme, "EOF");
+        if (lexer->unclosed_comment) token.error = ERROR_UNCLOSED_COMMENT;
         return token;
     }
 
-    // get current character
-    c = input[*pos];
-
-    // Comment handler
-    // Single line comment
-    if (c == '#') {
-        do{
-            (*pos)++;
-            c = input[*pos];
-        } while(c != '\n');
-        //skip newline character
-        (*pos)++;
-        c = input[*pos];
-
-        while(c == ' ' || c == '\t' || c == '\n'  && c != '\0'){
-            (*pos)++;
-            c = input[*pos];
-        }
-    }
-
-    // Multi line comment
-    // should skip until */ is reached
-    if (c == '/' && input[*pos + 1] == '*') {
-        (*pos)++; // skip /
-        // c = input[*pos];
-        do{
-            (*pos)++; //move ahead (will also skip asterisk in /*)
-            c = input[*pos];
-            if (c == '\0') {
-                printf("[WARN]: Unclosed comment\n");
-                break;
-            }
-        }while((c != '*') && (input[*pos + 1] != '/'));
-        (*pos)+=2; // move ahead of */
-        c = input[*pos];
-        //skip to start of next token
-        while(c == ' ' || c == '\t' || c == '\n'  && c != '\0'){
-            (*pos)++;
-            c = input[*pos];
-        }
-    }
-
     // Number handler
     // FIX THE IDENTIFIER/DIGIT CHECKING (10x should throw an error)
     if (isdigit(c)) {
-        int i = 0;
         do {
-            token.lexeme[i++] = c;
             (*pos)++;
             c = input[*pos];
-        } while (isdigit(c) && i < sizeof(token.lexeme) - 1);
+        } while (isdigit(c));
 
-        token.lexeme[i] = '\0';
+        token.length = *pos - token.offset;
         token.type = TOKEN_NUMBER;
-        last_token_type = 'n'; //number
+        lexer->last_token_type = 'n'; //number
         return token;
     }
 
     // Keyword and Identifier handler
     if(isalpha(c) || c == '_'){
-        int i = 0;
-        do {
-            token.lexeme[i++] = c;
-            (*pos)++;
-            c = input[*pos];
-        } while ((isalnum(c) || c == '_') && i < sizeof(token.lexeme) - 1);
-
-        token.lexeme[i] = '\0';
+        *pos = (int)scan_identifier(input, *pos);
+        token.length = *pos - token.offset;
 
         // Check if it's a keyword
-        TokenType keyword_type = IsKeyword(token.lexeme);
+        TokenType keyword_type = IsKeyword(input + token.offset, token.length);
         if (keyword_type) {
             token.type = keyword_type;
-            last_token_type = 'k'; //keyword
+            lexer->last_token_type = 'k'; //keyword
         } else {
             token.type = TOKEN_IDENTIFIER;
-            last_token_type = 'i'; //identifier
+            lexer->last_token_type = 'i'; //identifier
         }
         return token;
     }
 
     // Special character handler
     if((c == '&' && input[*pos + 1] != '&') || c == '_') {
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
+        token.length = 1;
         token.type = TOKEN_SPECIAL_CHARACTER;
         (*pos)++;
-        last_token_type = 'z'; //special character
+        lexer->last_token_type = 'z'; //special character
         return token;
     }
 
     // String literal handler
+    // The token spans both quotes, escapes are only checked here and decoded later by token_decode
     if(c == '"'){
-        int i = 0;
-        token.lexeme[i++] = c;
         (*pos)++;
         do{
-            // check to see if string is too long (above 100 characters)
-            if(i >= sizeof(token.lexeme) - 1) {
-                token.error = ERROR_STRING_OVERFLOW;
-                token.lexeme[i] = '\0';
-                last_token_type = 'e'; // error
-                (*pos)++;
-                char overflow = input[*pos];
-                // continues until the string is closed, just doesn't save the string data anymore
-                while(overflow != '\"') {
-                    // have to check for EOF to ensure string is terminated at some point
-                    if (input[*pos] == '\0') {
-                        token.error = ERROR_UNTERMINATED_STRING;
-                        break;
-                    }
-                    // continue to track but not save
-                    overflow = input[*pos];
-                    (*pos)++;
-                }
-                break;
-            }
-            // get character for comparison
+            // skip the run of plain characters up to the next quote, escape or end of file
+            *pos = (int)scan_string(input, *pos);
             char c_string = input[*pos];
             // closing quotation case
             if (c_string == '\"') {
-                token.lexeme[i++] = c_string;
-                token.lexeme[i] = '\0';
                 token.type = TOKEN_STRING_LITERAL;
-                last_token_type = 's'; //string
+                lexer->last_token_type = 's'; //string
                 (*pos)++;
                 break;
             }
             // end of file means unterminated
             if (c_string == '\0') {
                 token.error = ERROR_UNTERMINATED_STRING;
-                token.lexeme[i] = '\0';
-                last_token_type = 'e'; //error
+                lexer->last_token_type = 'e'; //error
                 break;
             }
             // case of escape character
-            if (c_string == '\\' && i <= sizeof(token.lexeme) - 1) {
-                // introduces niche case of the character that overflows the token size, might need its own handler
-                char c_escape = input[*pos+1];
-                switch (c_escape) {
-                    case '\\':
-                    case '\'':
-                    case '\"':
-                        // characters that are on their own
-                        token.lexeme[i++] = c_escape;
-                        (*pos) += 2;
-                        break;
-                    case 'n':
-                        // newline
-                        token.lexeme[i++] = '\n';
-                        (*pos) += 2;
-                        break;
-                    case 'r':
-                        // carriage return
-                        token.lexeme[i++] = '\r';
-                        (*pos) += 2;
-                        break;
-                    case 't':
-                        // tab
-                        token.lexeme[i++] = '\t';
-                        (*pos) += 2;
-                        break;
-                    default:
-                        // unrecognized escape character
-                        token.error = ERROR_INVALID_ESCAPE_CHARACTER;
-                        token.lexeme[i++] = c_string;
-                        token.lexeme[i++] = c_escape;
-                        last_token_type = 'e'; // error
-                        (*pos) += 2;
-                        break;
-                }
-            } else { // case of any valid character
-                token.lexeme[i++] = c_string;
-                (*pos)++;
+            char c_escape = input[*pos+1];
+            switch (c_escape) {
+                case '\\':
+                case '\'':
+                case '\"':
+                case 'n':
+                case 'r':
+                case 't':
+                    (*pos) += 2;
+                    break;
+                case '\0':
+                    // backslash right before the end of file
+                    (*pos)++;
+                    break;
+                default:
+                    // unrecognized escape character
+                    token.error = ERROR_INVALID_ESCAPE_CHARACTER;
+                    lexer->last_token_type = 'e'; // error
+                    (*pos) += 2;
+                    break;
             }
         } while(1);
 
         // returning
+        token.length = *pos - token.offset;
         return token;
     }
 
@@ -343,67 +360,50 @@ Token get_next_token(const char *input, int *pos) {
         // following character should be an escape character
         char c_char = input[*pos+1];
         if(c_char == '\\') {
-            // check it gets closed, if not skip 4 characters and continue
-            if (input[*pos+3] != '\'') {
+            // check it gets closed, if not skip 4 characters (never past the end of file) and continue
+            if (input[*pos+2] == '\0' || input[*pos+3] != '\'') {
                 token.error = ERROR_UNTERMINATED_CHARACTER;
-                token.lexeme[0] = c_char;
-                token.lexeme[1] = '\0';
-                last_token_type = 'e'; //error
-                (*pos) += 4;
+                lexer->last_token_type = 'e'; //error
+                (*pos) += input[*pos+2] == '\0' ? 2 : input[*pos+3] == '\0' ? 3 : 4;
+                token.length = *pos - token.offset;
                 return token;
             }
             // case block for all escape characters supported by the system
             char c_escape = input[*pos+2];
+            (*pos) += 4;
+            token.length = 4;
             switch (c_escape) {
                 case '\\':
                 case '\'':
                 case '\"':
-                    // basic escape chars
-                    token.lexeme[0] = c_escape;
-                    token.lexeme[1] = '\0';
-                    break;
                 case 'n':
-                    // newline
-                    token.lexeme[0] = '\n';
-                    token.lexeme[1] = '\0';
-                    break;
                 case 'r':
-                    // carriage return
-                    token.lexeme[0] = '\r';
-                    token.lexeme[1] = '\0';
-                    break;
                 case 't':
-                    // tab
-                    token.lexeme[0] = '\t';
-                    token.lexeme[1] = '\0';
                     break;
                 default:
                     // unrecognized escape character
                     token.error = ERROR_INVALID_ESCAPE_CHARACTER;
-                    last_token_type = 'e'; // error
-                    (*pos) += 4;
+                    lexer->last_token_type = 'e'; // error
                     return token;
             }
             token.type = TOKEN_CHAR_LITERAL;
-            last_token_type = 'x'; // escape char
-            (*pos) += 4;
+            lexer->last_token_type = 'x'; // escape char
             return token;
         }
 
         // unterminated character
-        if (input[*pos+2] != '\'') {
+        if (c_char == '\0' || input[*pos+2] != '\'') {
             token.error = ERROR_UNTERMINATED_CHARACTER;
-            last_token_type = 'e'; // error
-            (*pos) += 3;
+            lexer->last_token_type = 'e'; // error
+            (*pos) += c_char == '\0' ? 1 : input[*pos+2] == '\0' ? 2 : 3;
         }
         else {  // any valid character
-            token.lexeme[0] = c_char;
-            token.lexeme[1] = '\0';
             token.type = TOKEN_CHAR_LITERAL;
             *pos += 3;
-            last_token_type = 'c'; // char
+            lexer->last_token_type = 'c'; // char
         }
         // the char literal handler can finally return
+        token.length = *pos - token.offset;
         return token;
     }
 
@@ -438,10 +438,9 @@ Token get_next_token(const char *input, int *pos) {
         || c == '%' || c == '=' || c == '!'  || c == '|'
         || c == '^' || c == '&' || c == '<' || c== '>') {
         // Check for consecutive operators
-        if (last_token_type == 'o' && c != '!' && c != '$') {
+        if (lexer->last_token_type == 'o' && c != '!' && c != '$') {
             token.error = ERROR_CONSECUTIVE_OPERATORS;
-            token.lexeme[0] = c;
-            token.lexeme[1] = '\0';
+            token.length = 1;
             (*pos)++;
             return token;
         }
@@ -453,40 +452,35 @@ Token get_next_token(const char *input, int *pos) {
             case '+':
             case '-':
                 // +, - case
-                token.lexeme[0] = c;
-                token.lexeme[1] = '\0';
-                token.type = TOKEN_OPERATOR;
+                token.length = 1;
+                token.type = c == '+' ? TOKEN_PLUS : TOKEN_MINUS;
                 *pos += 1;
-                last_token_type = 'o'; // operator
+                lexer->last_token_type = 'o'; // operator
                 break;
 
             case '*':
             case '/':
             case '%':
                 // *, /, %,
-                token.lexeme[0] = c;
-                token.lexeme[1] = '\0';
-                token.type = TOKEN_OPERATOR;
+                token.length = 1;
+                token.type = c == '*' ? TOKEN_STAR : c == '/' ? TOKEN_SLASH : TOKEN_PERCENT;
                 *pos += 1;
-                last_token_type = 'o'; // operator
+                lexer->last_token_type = 'o'; // operator
                 break;
 
             case '=':
                 if (c_next == '=') {
                     // == case
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_COMPARITIVE;
+                    token.length = 2;
+                    token.type = TOKEN_EQUAL_EQUAL;
                     *pos += 2;
-                    last_token_type = 'c'; // comparative
+                    lexer->last_token_type = 'c'; // comparative
                 } else {
                     // =
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = '\0';
+                    token.length = 1;
                     token.type = TOKEN_EQUALS;
                     *pos += 1;
-                    last_token_type = 'e'; // equals
+                    lexer->last_token_type = 'e'; // equals
                 }
                 break;
 
@@ -494,18 +488,15 @@ Token get_next_token(const char *input, int *pos) {
             case '!':
                 if (c_next == '=') {
                     //!= case
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_COMPARITIVE;
+                    token.length = 2;
+                    token.type = TOKEN_NOT_EQUAL;
                     *pos += 2;
-                    last_token_type = 'c'; // comparative
+                    lexer->last_token_type = 'c'; // comparative
                 } else {
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = '\0';
-                    token.type = TOKEN_OPERATOR;
+                    token.length = 1;
+                    token.type = TOKEN_NOT;
                     *pos += 1;
-                    last_token_type = 'u'; // repeatable operator (unary)
+                    lexer->last_token_type = 'u'; // repeatable operator (unary)
                 }
                 break;
             
@@ -513,12 +504,16 @@ Token get_next_token(const char *input, int *pos) {
             case '|':
                 if (c_next == c) {
                     // ||
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_OPERATOR;
+                    token.length = 2;
+                    token.type = TOKEN_OR;
                     *pos += 2;
-                    last_token_type = 'o'; // comparative
+                    lexer->last_token_type = 'o'; // comparative
+                } else {
+                    // a lone | is not an operator
+                    token.error = ERROR_INVALID_CHAR;
+                    token.length = 1;
+                    *pos += 1;
+                    lexer->last_token_type = 'e'; // error
                 }
                 break;
 
@@ -526,12 +521,16 @@ Token get_next_token(const char *input, int *pos) {
             case '^':
                 if (c_next == c) {
                     // ^^
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_OPERATOR;
+                    token.length = 2;
+                    token.type = TOKEN_POWER;
                     *pos += 2;
-                    last_token_type = 'o'; // operator
+                    lexer->last_token_type = 'o'; // operator
+                } else {
+                    // a lone ^ is not an operator
+                    token.error = ERROR_INVALID_CHAR;
+                    token.length = 1;
+                    *pos += 1;
+                    lexer->last_token_type = 'e'; // error
                 }
                 break;
 
@@ -539,12 +538,10 @@ Token get_next_token(const char *input, int *pos) {
             case '&':
                 if (c_next == c) {
                     // &&
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_OPERATOR;
+                    token.length = 2;
+                    token.type = TOKEN_AND;
                     *pos += 2;
-                    last_token_type = 'c'; // comparative
+                    lexer->last_token_type = 'c'; // comparative
                 }
                 break;
 
@@ -553,29 +550,25 @@ Token get_next_token(const char *input, int *pos) {
             case '>':
                 if (c_next == '=') {
                     // <=, >=
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = c_next;
-                    token.lexeme[2] = '\0';
-                    token.type = TOKEN_COMPARITIVE;
+                    token.length = 2;
+                    token.type = c == '<' ? TOKEN_LESS_EQUAL : TOKEN_GREATER_EQUAL;
                     *pos += 2;
-                    last_token_type = 'o'; // operator
+                    lexer->last_token_type = 'o'; // operator
                 } else {
                     // <, >
-                    token.lexeme[0] = c;
-                    token.lexeme[1] = '\0';
-                    token.type = TOKEN_COMPARITIVE;
+                    token.length = 1;
+                    token.type = c == '<' ? TOKEN_LESS : TOKEN_GREATER;
                     *pos += 1;
-                    last_token_type = 'o'; // operator
+                    lexer->last_token_type = 'o'; // operator
                 }
                 break;
 
             case '$':
                 // $ is factorial
-                token.lexeme[0] = c;
-                token.lexeme[1] = '\0';
+                token.length = 1;
                 token.type = TOKEN_FACTORIAL;
                 *pos += 1;
-                last_token_type = 'u'; //technically infinitely repeatable $$5 so unary
+                lexer->last_token_type = 'u'; //technically infinitely repeatable $$5 so unary
                 break;
 
             // If it somehow caught the operator but couldn't identify it, this catches it
@@ -589,54 +582,48 @@ Token get_next_token(const char *input, int *pos) {
     // Brackets, parentheses, and brace handler
     if (c == '(') {
         token.type = TOKEN_LEFTPARENTHESES;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
 
     if (c == ')') {
         token.type = TOKEN_RIGHTPARENTHESES;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
 
     if (c == '{') {
         token.type = TOKEN_LEFTBRACE;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
 
     if (c == '}') {
         token.type = TOKEN_RIGHTBRACE;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
 
     if (c == '[') {
         token.type = TOKEN_LEFTBRACKET;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
 
     if (c == ']') {
         token.type = TOKEN_RIGHTBRACKET;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'b'; //brackets (any type)
+        token.length = 1;
+        lexer->last_token_type = 'b'; //brackets (any type)
         (*pos)++;
         return token;
     }
@@ -644,9 +631,8 @@ Token get_next_token(const char *input, int *pos) {
     // SemiColon needs it own handler
     if (c == ';') {
         token.type = TOKEN_SEMICOLON;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'd'; //delimiter
+        token.length = 1;
+        lexer->last_token_type = 'd'; //delimiter
         (*pos)++;
         return token;
     }
@@ -654,116 +640,62 @@ Token get_next_token(const char *input, int *pos) {
     // Other delimiters
     if (c == ',') {
         token.type = TOKEN_COMMA;
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-        last_token_type = 'd'; //delimiter
+        token.length = 1;
+        lexer->last_token_type = 'd'; //delimiter
         (*pos)++;
         return token;
     }
 
     // Handle invalid characters
     token.error = ERROR_INVALID_CHAR;
-    token.lexeme[0] = c;
-    token.lexeme[1] = '\0';
-    last_token_type = 'e'; //error
+    token.length = 1;
+    lexer->last_token_type = 'e'; //error
     (*pos)++;
     return token;
 }
+#endif /* LEXER_DFA */
+
+/* Start lexing source from its first byte */
+void lexer_init(LexerState *lexer, const Source *source) {
+    lexer->source = source;
+    lexer->pos = 0;
+    lexer->last_token_type = 'y';
+    lexer->unclosed_comment = 0;
+}
+
+/* Get next token from input */
+// Build with -DLEXER_DFA to use the table-driven engine instead of the hand-written scanner
+Token get_next_token(LexerState *lexer) {
+#ifdef LEXER_DFA
+    return dfa_next_token(lexer);
+#else
+    return hand_next_token(lexer);
+#endif
+}
 /*
 int main() {
-    // get file
-    FILE *file = fopen("../phase2-w25/test/input_valid.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
-
-    // get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    char *buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
-
-    // fill buffer with full file of chars in order
-    size_t bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    size_t b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
+    const char *paths[] = {"../phase2-w25/test/input_valid.txt", "../phase2-w25/test/input_invalid.txt"};
+    const char *titles[] = {"Analyzing Correct Input", "Analyzing Incorrect Input"};
+    for (int i = 0; i < 2; i++) {
+        // get file, the lexer skips the \r of CRLF line endings as whitespace
+        Source source;
+        if (!source_load(&source, paths[i])) {
+            return 1;
         }
-    }
-    buffer[b] = '\0';
-
-    // start at beginning of buffer
-    int position = 0;
-    Token token;
-
-    // perform tokenization
-    printf("Analyzing Correct Input:\n%s\n\n", buffer);
-    do {
-        token = get_next_token(buffer, &position);
-        print_token(token);
-    } while (token.type != TOKEN_EOF);
-
-    // free memory and close file
-    free(buffer);
-    fclose(file);
-
-    // Repeat for Incorrect file
-    current_line = 1;
-
-    // get file
-    file = fopen("../phase2-w25/test/input_invalid.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
 
-    // get file size
-    fseek(file, 0, SEEK_END);
-    file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
+        // perform tokenization
+        printf("%s:\n%s\n\n", titles[i], source.data);
+        LexerState lexer;
+        lexer_init(&lexer, &source);
+        Token token;
+        do {
+            token = get_next_token(&lexer);
+            print_token(&source, token);
+        } while (token.type != TOKEN_EOF);
 
-    // fill buffer with full file of chars in order
-    bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
-        }
+        // free memory "he ain't deserve to be locked up"
+        source_free(&source);
     }
-    buffer[b] = '\0';
-
-    // start at beginning of buffer
-    position = 0;
-
-    // perform tokenization
-    printf("Analyzing Incorrect Input:\n%s\n\n", buffer);
-    do {
-        token = get_next_token(buffer, &position);
-        print_token(token);
-    } while (token.type != TOKEN_EOF);
-
-    // free memory "he ain't deserve to be locked up"
-    free(buffer);
-    fclose(file);
     return 0;
 }
 */
\ No newline at end of file
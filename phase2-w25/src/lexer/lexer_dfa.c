@@ -0,0 +1,330 @@
+/* lexer_dfa.c */
+#include <stdio.h>
+#include <string.h>
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+#include "../../include/scan.h"
+
+/* Table-driven lexer engine.
+ * Every input byte is mapped to a character class by a single table lookup, operators and
+ * delimiters are recognised by walking a transition table over those classes, and keywords
+ * are found with a perfect hash instead of a strcmp scan. The tokens produced are the same as
+ * the hand-written scanner in lexer.c, which stays available as the default build. */
+
+// Character classes (CC_OTH must stay 0 so bytes above 127 default to it)
+enum {
+    CC_OTH,     // anything not listed below, invalid character
+    CC_NUL,     // end of input
+    CC_SP,      // space, tab and the \r of \r\n
+    CC_NL,      // newline
+    CC_DIG,     // 0-9
+    CC_ALP,     // a-z A-Z _
+    CC_DQ,      // "
+    CC_SQ,      // '
+    CC_HSH,     // #
+    CC_SLS,     // /
+    CC_STR,     // *
+    CC_PLS,     // +
+    CC_MIN,     // -
+    CC_PCT,     // %
+    CC_EQ,      // =
+    CC_BNG,     // !
+    CC_PIP,     // |
+    CC_CAR,     // ^
+    CC_AMP,     // &
+    CC_LT,      // <
+    CC_GT,      // >
+    CC_DOL,     // $
+    CC_LPR, CC_RPR, CC_LBC, CC_RBC, CC_LBK, CC_RBK,
+    CC_SEM,     // ;
+    CC_COM,     // ,
+    CC_COUNT
+};
+
+static const unsigned char char_class[256] = {
+    CC_NUL, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_SP, CC_NL, CC_OTH, CC_OTH, CC_SP, CC_OTH, CC_OTH,
+    CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH, CC_OTH,
+    CC_SP, CC_BNG, CC_DQ, CC_HSH, CC_DOL, CC_PCT, CC_AMP, CC_SQ, CC_LPR, CC_RPR, CC_STR, CC_PLS, CC_COM, CC_MIN, CC_OTH, CC_SLS,
+    CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_DIG, CC_OTH, CC_SEM, CC_LT, CC_EQ, CC_GT, CC_OTH,
+    CC_OTH, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP,
+    CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_LBK, CC_OTH, CC_RBK, CC_CAR, CC_ALP,
+    CC_OTH, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP,
+    CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_ALP, CC_LBC, CC_PIP, CC_RBC, CC_OTH, CC_OTH,
+};
+
+// DFA states for operators and delimiters, S_DEAD means no transition
+enum {
+    S_DEAD,
+    S_START,
+    S_PLUS, S_MINUS, S_STAR, S_SLASH, S_PERCENT,
+    S_EQ,           // =
+    S_EQEQ,         // ==
+    S_BANG,         // !
+    S_BANGEQ,       // !=
+    S_PIPE,         // | (not accepting)
+    S_PIPEPIPE,     // ||
+    S_CARET,        // ^ (not accepting)
+    S_CARETCARET,   // ^^
+    S_AMP,          // & (special character)
+    S_AMPAMP,       // &&
+    S_LESS, S_GREATER,
+    S_LESSEQ, S_GREATEREQ,
+    S_DOLLAR,       // $
+    S_LPAREN, S_RPAREN, S_LBRACE, S_RBRACE, S_LBRACKET, S_RBRACKET,
+    S_SEMICOLON,
+    S_COMMA,
+    S_COUNT
+};
+
+static const unsigned char dfa_next[S_COUNT][CC_COUNT] = {
+    [S_START] = {
+        [CC_PLS] = S_PLUS, [CC_MIN] = S_MINUS, [CC_STR] = S_STAR, [CC_SLS] = S_SLASH, [CC_PCT] = S_PERCENT,
+        [CC_EQ] = S_EQ, [CC_BNG] = S_BANG, [CC_PIP] = S_PIPE, [CC_CAR] = S_CARET,
+        [CC_AMP] = S_AMP, [CC_LT] = S_LESS, [CC_GT] = S_GREATER, [CC_DOL] = S_DOLLAR,
+        [CC_LPR] = S_LPAREN, [CC_RPR] = S_RPAREN, [CC_LBC] = S_LBRACE,
+        [CC_RBC] = S_RBRACE, [CC_LBK] = S_LBRACKET, [CC_RBK] = S_RBRACKET,
+        [CC_SEM] = S_SEMICOLON, [CC_COM] = S_COMMA,
+    },
+    [S_EQ]    = { [CC_EQ] = S_EQEQ },
+    [S_BANG]  = { [CC_EQ] = S_BANGEQ },
+    [S_PIPE]  = { [CC_PIP] = S_PIPEPIPE },
+    [S_CARET] = { [CC_CAR] = S_CARETCARET },
+    [S_AMP]   = { [CC_AMP] = S_AMPAMP },
+    [S_LESS]    = { [CC_EQ] = S_LESSEQ },
+    [S_GREATER] = { [CC_EQ] = S_GREATEREQ },
+};
+
+// What each final state produces; TOKEN_ERROR marks a non-accepting state
+// check_consecutive follows the hand-written rule that only ! and $ may follow an operator
+static const struct {
+    TokenType type;
+    char last_token_type;
+    char check_consecutive;
+} dfa_accept[S_COUNT] = {
+    [S_DEAD]        = {TOKEN_ERROR, 'e', 0},
+    [S_START]       = {TOKEN_ERROR, 'e', 0},
+    [S_PLUS]        = {TOKEN_PLUS, 'o', 1},
+    [S_MINUS]       = {TOKEN_MINUS, 'o', 1},
+    [S_STAR]        = {TOKEN_STAR, 'o', 1},
+    [S_SLASH]       = {TOKEN_SLASH, 'o', 1},
+    [S_PERCENT]     = {TOKEN_PERCENT, 'o', 1},
+    [S_EQ]          = {TOKEN_EQUALS, 'e', 1},
+    [S_EQEQ]        = {TOKEN_EQUAL_EQUAL, 'c', 1},
+    [S_BANG]        = {TOKEN_NOT, 'u', 0},
+    [S_BANGEQ]      = {TOKEN_NOT_EQUAL, 'c', 0},
+    [S_PIPE]        = {TOKEN_ERROR, 'e', 1},
+    [S_PIPEPIPE]    = {TOKEN_OR, 'o', 1},
+    [S_CARET]       = {TOKEN_ERROR, 'e', 1},
+    [S_CARETCARET]  = {TOKEN_POWER, 'o', 1},
+    [S_AMP]         = {TOKEN_SPECIAL_CHARACTER, 'z', 0},
+    [S_AMPAMP]      = {TOKEN_AND, 'c', 1},
+    [S_LESS]        = {TOKEN_LESS, 'o', 1},
+    [S_GREATER]     = {TOKEN_GREATER, 'o', 1},
+    [S_LESSEQ]      = {TOKEN_LESS_EQUAL, 'o', 1},
+    [S_GREATEREQ]   = {TOKEN_GREATER_EQUAL, 'o', 1},
+    [S_DOLLAR]      = {TOKEN_FACTORIAL, 'u', 0},
+    [S_LPAREN]      = {TOKEN_LEFTPARENTHESES, 'b', 0},
+    [S_RPAREN]      = {TOKEN_RIGHTPARENTHESES, 'b', 0},
+    [S_LBRACE]      = {TOKEN_LEFTBRACE, 'b', 0},
+    [S_RBRACE]      = {TOKEN_RIGHTBRACE, 'b', 0},
+    [S_LBRACKET]    = {TOKEN_LEFTBRACKET, 'b', 0},
+    [S_RBRACKET]    = {TOKEN_RIGHTBRACKET, 'b', 0},
+    [S_SEMICOLON]   = {TOKEN_SEMICOLON, 'd', 0},
+    [S_COMMA]       = {TOKEN_COMMA, 'd', 0},
+};
+
+// Decoded value of each supported escape character, 0 if unsupported
+static const char escape_value[256] = {
+    ['\\'] = '\\', ['\''] = '\'', ['"'] = '"', ['n'] = '\n', ['r'] = '\r', ['t'] = '\t',
+};
+
+/* Keyword perfect hash: (4 * first char + length) & 15 is collision free for the keyword set.
+ * An identifier is a keyword only if the slot it hashes to holds exactly the same word. */
+#define KEYWORD_HASH(word, len) ((4 * (unsigned char)(word)[0] + (len)) & 15)
+
+static const struct {
+    const char* word;
+    int length;
+    TokenType type;
+} keyword_slots[16] = {
+    [0]  = {"char", 4, TOKEN_CHAR},
+    [1]  = {"while", 5, TOKEN_WHILE},
+    [2]  = {"string", 6, TOKEN_STRING},
+    [5]  = {"print", 5, TOKEN_PRINT},
+    [6]  = {"if", 2, TOKEN_IF},
+    [7]  = {"int", 3, TOKEN_INT},
+    [8]  = {"else", 4, TOKEN_ELSE},
+    [9]  = {"until", 5, TOKEN_UNTIL},
+    [12] = {"null", 4, TOKEN_NULL},
+    [13] = {"break", 5, TOKEN_BREAK},
+    [14] = {"repeat", 6, TOKEN_REPEAT},
+};
+
+static TokenType keyword_lookup(const char* word, int len) {
+    int slot = KEYWORD_HASH(word, len);
+    if (keyword_slots[slot].length == len && memcmp(keyword_slots[slot].word, word, len) == 0) {
+        return keyword_slots[slot].type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+
+// String literal, the span covers both quotes and escapes are only validated here
+static void dfa_string_literal(const char* input, int* pos, Token* token, char* last_token_type) {
+    (*pos)++;
+    while (1) {
+        // plain run up to the next quote, backslash or end of input
+        *pos = (int)scan_string(input, *pos);
+        char c = input[*pos];
+        if (c == '"') {
+            token->type = TOKEN_STRING_LITERAL;
+            *last_token_type = 's';
+            (*pos)++;
+            break;
+        }
+        if (c == '\0' || input[*pos + 1] == '\0') {
+            // end of input, possibly right after a backslash
+            token->error = ERROR_UNTERMINATED_STRING;
+            *last_token_type = 'e';
+            *pos += c == '\0' ? 0 : 1;
+            break;
+        }
+        if (!escape_value[(unsigned char)input[*pos + 1]]) {
+            token->error = ERROR_INVALID_ESCAPE_CHARACTER;
+            *last_token_type = 'e';
+        }
+        (*pos) += 2;
+    }
+    token->length = *pos - token->offset;
+}
+
+// Char literal, 'c' or an escape such as '\n'
+static void dfa_char_literal(const char* input, int* pos, Token* token, char* last_token_type) {
+    char c_char = input[*pos + 1];
+    if (c_char == '\\') {
+        if (input[*pos + 2] == '\0' || input[*pos + 3] != '\'') {
+            token->error = ERROR_UNTERMINATED_CHARACTER;
+            *last_token_type = 'e';
+            // never step past the end of input
+            (*pos) += input[*pos + 2] == '\0' ? 2 : input[*pos + 3] == '\0' ? 3 : 4;
+        } else if (!escape_value[(unsigned char)input[*pos + 2]]) {
+            token->error = ERROR_INVALID_ESCAPE_CHARACTER;
+            *last_token_type = 'e';
+            (*pos) += 4;
+        } else {
+            token->type = TOKEN_CHAR_LITERAL;
+            *last_token_type = 'x';
+            (*pos) += 4;
+        }
+    } else if (c_char == '\0' || input[*pos + 2] != '\'') {
+        token->error = ERROR_UNTERMINATED_CHARACTER;
+        *last_token_type = 'e';
+        (*pos) += c_char == '\0' ? 1 : input[*pos + 2] == '\0' ? 2 : 3;
+    } else {
+        token->type = TOKEN_CHAR_LITERAL;
+        *last_token_type = 'c';
+        (*pos) += 3;
+    }
+    token->length = *pos - token->offset;
+}
+
+Token dfa_next_token(LexerState* lexer) {
+    const char* input = lexer->source->data;
+    int* pos = &lexer->pos;
+    char* last_token_type = &lexer->last_token_type;
+    Token token = {.type = TOKEN_ERROR, .error = ERROR_NONE};
+    const unsigned char* s = (const unsigned char*)input;
+    int p = *pos;
+
+    // Skip whitespace and comments
+    while (1) {
+        unsigned char cls = char_class[s[p]];
+        if (cls == CC_SP || cls == CC_NL) {
+            p = (int)scan_whitespace(input, p);
+        } else if (cls == CC_HSH) {
+            p = (int)scan_line_end(input, p);
+        } else if (cls == CC_SLS && s[p + 1] == '*') {
+            p = (int)scan_comment_end(input, p + 2);
+            if (s[p] == '\0') {
+                lexer->unclosed_comment = 1;
+            } else {
+                p += 2;
+            }
+        } else {
+            break;
+        }
+    }
+    token.offset = p;
+    *pos = p;
+
+    switch (char_class[s[p]]) {
+        case CC_NUL:
+            token.type = TOKEN_EOF;
+            if (lexer->unclosed_comment) token.error = ERROR_UNCLOSED_COMMENT;
+            return token;
+
+        case CC_DIG: {
+            do {
+                p++;
+            } while (char_class[s[p]] == CC_DIG);
+            token.length = p - token.offset;
+            token.type = TOKEN_NUMBER;
+            *last_token_type = 'n';
+            *pos = p;
+            return token;
+        }
+
+        case CC_ALP: {
+            p = (int)scan_identifier(input, p);
+            token.length = p - token.offset;
+            token.type = keyword_lookup(input + token.offset, token.length);
+            *last_token_type = token.type == TOKEN_IDENTIFIER ? 'i' : 'k';
+            *pos = p;
+            return token;
+        }
+
+        case CC_DQ:
+            dfa_string_literal(input, pos, &token, last_token_type);
+            return token;
+
+        case CC_SQ:
+            dfa_char_literal(input, pos, &token, last_token_type);
+            return token;
+
+        default:
+            break;
+    }
+
+    // Operators and delimiters: follow transitions for as long as there is one
+    int state = dfa_next[S_START][char_class[s[p]]];
+    int length = 0;
+    if (state != S_DEAD) {
+        length = 1;
+        int next = dfa_next[state][char_class[s[p + 1]]];
+        if (next != S_DEAD) {
+            state = next;
+            length = 2;
+        }
+    }
+
+    if (dfa_accept[state].check_consecutive && *last_token_type == 'o') {
+        token.error = ERROR_CONSECUTIVE_OPERATORS;
+        token.length = 1;
+        (*pos)++;
+        return token;
+    }
+
+    if (dfa_accept[state].type == TOKEN_ERROR) {
+        // Handle invalid characters, including a lone | or ^
+        token.error = ERROR_INVALID_CHAR;
+        token.length = 1;
+        *last_token_type = 'e';
+        (*pos)++;
+        return token;
+    }
+
+    token.length = length;
+    token.type = dfa_accept[state].type;
+    *last_token_type = dfa_accept[state].last_token_type;
+    *pos = p + length;
+    return token;
+}
@@ -0,0 +1,138 @@
+/* lexer_incremental.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+/* Re-lexing after an edit.
+ * A token only depends on the bytes from its start up to one byte past its end, and on whether the token
+ * before it was an operator (the consecutive operator check is the only place the lexer looks back). So:
+ * 1. Lexing restarts right after the last token that ends before the edit and cannot leave the lexer in
+ *    operator state, which leaves the tokens before it as they are.
+ * 2. Tokens are lexed until one past the inserted text starts where an old token started, with the same
+ *    type, error and length, and again without operator state. Both lexers are in the same state there and
+ *    read the same bytes from then on, so every old token from that one on is kept, shifted.
+ * 3. The new tokens replace the old ones in between, and the kept tokens move by the change in length. */
+
+// Tokens after which the lexer is never in operator state
+static int resets_state(TokenType type) {
+    switch (type) {
+        case TOKEN_PLUS ... TOKEN_OR:
+        case TOKEN_LESS: case TOKEN_GREATER:
+        case TOKEN_LESS_EQUAL: case TOKEN_GREATER_EQUAL:
+        case TOKEN_ERROR:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// Last token that ends before offset and resets the lexer state, or tokens->count when there is none
+static size_t restart_token(const TokenBuffer* buffer, size_t offset) {
+    // Token ends grow with the index, find the last one below offset
+    size_t low = 0, high = buffer->count - 1; // TOKEN_EOF never ends before an edit
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if ((size_t)buffer->offsets[mid] + buffer->lengths[mid] < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // low tokens end before offset
+    while (low > 0 && !resets_state((TokenType)buffer->types[low - 1])) low--;
+    return low == 0 ? buffer->count : low - 1;
+}
+
+typedef struct {
+    Token* tokens;
+    size_t count;
+    size_t capacity;
+} TokenList;
+
+static int token_list_push(TokenList* list, Token token) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        Token* tokens = realloc(list->tokens, capacity * sizeof(Token));
+        if (!tokens) return 0;
+        list->tokens = tokens;
+        list->capacity = capacity;
+    }
+    list->tokens[list->count++] = token;
+    return 1;
+}
+
+int lex_edit(TokenBuffer* buffer, Source* source, size_t offset, size_t removed, const char* text, size_t length,
+             TokenEdit* edit) {
+    if (offset > source->length || removed > source->length - offset) return 0;
+    size_t restart = restart_token(buffer, offset);
+    size_t first = restart == buffer->count ? 0 : restart + 1;
+    size_t position = first == 0 ? 0 : buffer->offsets[restart] + buffer->lengths[restart];
+    if (!source_edit(source, offset, removed, text, length)) return 0;
+
+    // Old offsets at and past the removed bytes map to new ones by delta
+    int64_t delta = (int64_t)length - (int64_t)removed;
+    LexerState lexer;
+    lexer_init(&lexer, source);
+    lexer.pos = (int)position;
+    TokenList list = {NULL, 0, 0};
+    size_t old = first;
+    while (1) {
+        Token token = get_next_token(&lexer);
+        if (token.offset >= offset + length) {
+            uint32_t mapped = (uint32_t)(token.offset - delta);
+            while (buffer->offsets[old] < mapped) old++; // TOKEN_EOF sits at the old length, past any mapped offset
+            if (buffer->offsets[old] == mapped && buffer->types[old] == token.type
+                && buffer->errors[old] == token.error && buffer->lengths[old] == token.length
+                && resets_state((TokenType)token.type)) {
+                break;
+            }
+        }
+        if (!token_list_push(&list, token)) {
+            free(list.tokens);
+            token_buffer_free(buffer);
+            return 0;
+        }
+        // The new TOKEN_EOF differs from the old one only when an unclosed comment was opened or closed
+        if (token.type == TOKEN_EOF) {
+            old = buffer->count;
+            break;
+        }
+    }
+
+    // Replace tokens [first, old) with the new ones
+    size_t kept = buffer->count - old;
+    size_t count = first + list.count + kept;
+    if (!token_buffer_reserve(buffer, count)) {
+        free(list.tokens);
+        token_buffer_free(buffer);
+        return 0;
+    }
+    size_t to = first + list.count;
+    memmove(buffer->types + to, buffer->types + old, kept * sizeof(uint8_t));
+    memmove(buffer->errors + to, buffer->errors + old, kept * sizeof(uint8_t));
+    memmove(buffer->offsets + to, buffer->offsets + old, kept * sizeof(uint32_t));
+    memmove(buffer->lengths + to, buffer->lengths + old, kept * sizeof(uint32_t));
+    memmove(buffer->atoms + to, buffer->atoms + old, kept * sizeof(Atom));
+    if (delta != 0) {
+        uint32_t shift = (uint32_t)delta;
+        for (size_t i = to; i < count; i++) buffer->offsets[i] += shift;
+    }
+    for (size_t i = 0; i < list.count; i++) {
+        Token token = list.tokens[i];
+        buffer->types[first + i] = token.type;
+        buffer->errors[first + i] = token.error;
+        buffer->offsets[first + i] = token.offset;
+        buffer->lengths[first + i] = token.length;
+        buffer->atoms[first + i] = token_atom(source->data, token);
+    }
+    buffer->count = count;
+    free(list.tokens);
+
+    edit->first = first;
+    edit->removed = old - first;
+    edit->inserted = list.count;
+    return 1;
+}
@@ -0,0 +1,367 @@
+/* lexer_parallel.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+#include "../../include/scan.h"
+
+/* Parallel chunked lexing of a single source.
+ * 1. Structural pre-pass: the source is cut into one region per thread and every region is run
+ *    through a small byte DFA that only knows strings, char literals and comments. A thread cannot
+ *    know the state its region starts in, so it runs the DFA from every possible entry state at
+ *    once (the runs merge within a few bytes except for the in-string one) and records the exit
+ *    state and the first safe newline (one outside strings and comments) for each entry state.
+ * 2. The region summaries are chained in order from the known start state, which picks one safe
+ *    newline per region as a chunk boundary.
+ * 3. Every chunk is lexed on its own thread into a local token array with the regular lexer,
+ *    starting with a fresh last_token_type.
+ * 4. The chunks are stitched in order. A chunk is kept when its first token and the lexer state
+ *    after it match the token the previous chunk lexed across the seam, anything else is re-lexed
+ *    from the real state, so the output never depends on the pre-pass being right. Tokens carry
+ *    no lines, so nothing needs fixing up across seams. An embedded NUL ends the input as it does
+ *    for lex_all, so the chunk that reaches TOKEN_EOF is the last one and the rest are dropped.
+ * 5. The chunks are copied into the token buffer in parallel.
+ *    Atoms are interned during the copy, the interner shards its table so the threads rarely contend.
+ * Small sources are lexed on the calling thread. */
+
+// Sources shorter than this per thread are not worth splitting
+#define MIN_CHUNK_BYTES (64 * 1024)
+#define MAX_THREADS 64
+
+/* --- STRUCTURAL PRE-PASS --- */
+enum {
+    P_CODE,
+    P_SLASH,        // code, after a '/'
+    P_STRING,
+    P_STRING_ESC,   // string, after a '\'
+    P_CHAR,         // after the opening '
+    P_CHAR_ESC,     // after '\ inside a char literal
+    P_CHAR_END,     // the byte closing a char literal (or ending a malformed one)
+    P_LINE,         // # comment
+    P_BLOCK,        // /* comment
+    P_BLOCK_STAR,   // /* comment, after a '*'
+    P_COUNT
+};
+
+enum {
+    PC_OTH,
+    PC_NL,
+    PC_DQ,
+    PC_SQ,
+    PC_HSH,
+    PC_SLS,
+    PC_STR,
+    PC_BSL,
+    PC_COUNT
+};
+
+static const unsigned char prepass_class[256] = {
+    ['\n'] = PC_NL, ['"'] = PC_DQ, ['\''] = PC_SQ, ['#'] = PC_HSH, ['/'] = PC_SLS, ['*'] = PC_STR, ['\\'] = PC_BSL,
+};
+
+// Mirrors how the lexer consumes strings, char literals and comments (a char literal always spans
+// 3 bytes, 4 with an escape, whether or not it is well formed)
+static const unsigned char prepass_next[P_COUNT][PC_COUNT] = {
+    //                 OTH           NL            DQ            SQ            HSH           SLS           STR           BSL
+    [P_CODE]       = {P_CODE,       P_CODE,       P_STRING,     P_CHAR,       P_LINE,       P_SLASH,      P_CODE,       P_CODE},
+    [P_SLASH]      = {P_CODE,       P_CODE,       P_STRING,     P_CHAR,       P_LINE,       P_SLASH,      P_BLOCK,      P_CODE},
+    [P_STRING]     = {P_STRING,     P_STRING,     P_CODE,       P_STRING,     P_STRING,     P_STRING,     P_STRING,     P_STRING_ESC},
+    [P_STRING_ESC] = {P_STRING,     P_STRING,     P_STRING,     P_STRING,     P_STRING,     P_STRING,     P_STRING,     P_STRING},
+    [P_CHAR]       = {P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_ESC},
+    [P_CHAR_ESC]   = {P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END,   P_CHAR_END},
+    [P_CHAR_END]   = {P_CODE,       P_CODE,       P_CODE,       P_CODE,       P_CODE,       P_CODE,       P_CODE,       P_CODE},
+    [P_LINE]       = {P_LINE,       P_CODE,       P_LINE,       P_LINE,       P_LINE,       P_LINE,       P_LINE,       P_LINE},
+    [P_BLOCK]      = {P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK_STAR, P_BLOCK},
+    [P_BLOCK_STAR] = {P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK,      P_BLOCK,      P_CODE,       P_BLOCK_STAR, P_BLOCK},
+};
+
+// A newline read in one of these states is whitespace between tokens
+static const unsigned char prepass_safe_newline[P_COUNT] = {
+    [P_CODE] = 1, [P_SLASH] = 1, [P_LINE] = 1,
+};
+
+// States that an ordinary byte moves out of, the byte after one of these cannot be skipped
+static const unsigned char prepass_transient[P_COUNT] = {
+    [P_SLASH] = 1, [P_STRING_ESC] = 1, [P_CHAR] = 1, [P_CHAR_ESC] = 1, [P_CHAR_END] = 1, [P_BLOCK_STAR] = 1,
+};
+
+// Pre-pass result for one region, indexed by entry state
+typedef struct {
+    const unsigned char* input;
+    size_t begin;
+    size_t end;
+    int all_entries;                // 0 for the first region, which always starts in P_CODE
+    unsigned char exit[P_COUNT];    // State after the region
+    size_t first_safe[P_COUNT];     // Offset of the first safe newline, SIZE_MAX if none
+} Region;
+
+static void prepass_region(Region* region) {
+    // One run per distinct state, entry states whose runs reach the same state share a run from then on
+    unsigned char state[P_COUNT];   // State of each run
+    unsigned char run_of[P_COUNT];  // Run followed by each entry state
+    int entries = region->all_entries ? P_COUNT : 1;
+    int runs = entries;
+    int pending = entries;          // Entry states still without a safe newline
+
+    for (int e = 0; e < P_COUNT; e++) {
+        state[e] = (unsigned char)e;
+        run_of[e] = (unsigned char)(e < entries ? e : 0);
+        region->first_safe[e] = SIZE_MAX;
+    }
+
+    // Ordinary bytes leave the stable states alone, so only the structural bytes (newlines, quotes,
+    // comment openers and backslashes) of each 64-byte block are visited, plus the byte after any
+    // transient state
+    const char* input = (const char*)region->input;
+    int transient = 0;
+    for (size_t block = region->begin; block < region->end;) {
+        int width = 64 - (int)((uintptr_t)(input + block) & 63);
+        uint64_t mask = scan_structural_mask(input, block);
+        if (transient) mask |= 1;
+
+        while (mask) {
+            int bit = __builtin_ctzll(mask);
+            size_t i = block + bit;
+            if (i >= region->end) break;
+            unsigned char cls = prepass_class[region->input[i]];
+
+            if (cls == PC_NL) {
+                for (int e = 0; pending && e < entries; e++) {
+                    if (region->first_safe[e] == SIZE_MAX && prepass_safe_newline[state[run_of[e]]]) {
+                        region->first_safe[e] = i;
+                        pending--;
+                    }
+                }
+            }
+            transient = 0;
+            for (int r = 0; r < runs; r++) {
+                state[r] = prepass_next[state[r]][cls];
+                transient |= prepass_transient[state[r]];
+            }
+
+            // Merge runs that met, the transient states die out within the first line
+            if (cls == PC_NL && runs > 1) {
+                unsigned char survivor[P_COUNT];
+                int merged = 0;
+                for (int r = 0; r < runs; r++) {
+                    int m = 0;
+                    while (m < merged && state[m] != state[r]) m++;
+                    if (m == merged) state[merged++] = state[r];
+                    survivor[r] = (unsigned char)m;
+                }
+                for (int e = 0; e < entries; e++) run_of[e] = survivor[run_of[e]];
+                runs = merged;
+            }
+
+            mask &= mask - 1;
+            // The byte after a transient state is visited whatever it is, in the next block if need be
+            if (transient && bit + 1 < width) mask |= 2ull << bit;
+        }
+        block += width;
+    }
+
+    // The first region only answers for P_CODE
+    for (int e = 0; e < P_COUNT; e++) region->exit[e] = state[run_of[e]];
+}
+
+/* --- CHUNK LEXING --- */
+typedef struct {
+    LexerState lexer;       // Lexer state, after `peek` once the chunk is lexed
+    size_t end;             // Tokens starting at or after end belong to the next chunk
+    Token* tokens;
+    size_t count;
+    size_t capacity;
+    int failed;             // Out of memory
+    Token first;            // First token lexed and the lexer state right after it
+    int first_pos;
+    char first_last_token_type;
+    Token peek;             // First token starting at or after end (the first token of the next chunk)
+} Chunk;
+
+static int chunk_push(Chunk* chunk, Token token) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 256;
+        Token* tokens = realloc(chunk->tokens, capacity * sizeof(Token));
+        if (!tokens) {
+            chunk->failed = 1;
+            return 0;
+        }
+        chunk->tokens = tokens;
+        chunk->capacity = capacity;
+    }
+    chunk->tokens[chunk->count++] = token;
+    return 1;
+}
+
+// Lexes tokens from token onwards until one starts at or after chunk->end, the end of input is kept
+// and leaves peek unset, since no chunk follows it
+static void chunk_lex_from(Chunk* chunk, Token token) {
+    while (token.offset < chunk->end) {
+        if (!chunk_push(chunk, token)) return;
+        if (token.type == TOKEN_EOF) return;
+        token = get_next_token(&chunk->lexer);
+    }
+    chunk->peek = token;
+}
+
+static int chunk_reached_eof(const Chunk* chunk) {
+    return chunk->count > 0 && chunk->tokens[chunk->count - 1].type == TOKEN_EOF;
+}
+
+static void chunk_lex(Chunk* chunk) {
+    Token token = get_next_token(&chunk->lexer);
+    chunk->first = token;
+    chunk->first_pos = chunk->lexer.pos;
+    chunk->first_last_token_type = chunk->lexer.last_token_type;
+    chunk_lex_from(chunk, token);
+}
+
+/* --- THREADS --- */
+typedef struct {
+    Region* regions;
+    Chunk* chunks;
+    TokenBuffer* out;
+    size_t* out_offset;
+    int count;
+    int stride;
+    int index;
+} Job;
+
+static void* prepass_job(void* arg) {
+    Job* job = arg;
+    for (int i = job->index; i < job->count; i += job->stride) prepass_region(&job->regions[i]);
+    return NULL;
+}
+
+static void* lex_job(void* arg) {
+    Job* job = arg;
+    for (int i = job->index; i < job->count; i += job->stride) chunk_lex(&job->chunks[i]);
+    return NULL;
+}
+
+static void* copy_job(void* arg) {
+    Job* job = arg;
+    for (int i = job->index; i < job->count; i += job->stride) {
+        Chunk* chunk = &job->chunks[i];
+        TokenBuffer* out = job->out;
+        size_t at = job->out_offset[i];
+        for (size_t t = 0; t < chunk->count; t++, at++) {
+            out->types[at] = chunk->tokens[t].type;
+            out->errors[at] = chunk->tokens[t].error;
+            out->offsets[at] = chunk->tokens[t].offset;
+            out->lengths[at] = chunk->tokens[t].length;
+            out->atoms[at] = token_atom(out->source->data, chunk->tokens[t]);
+        }
+    }
+    return NULL;
+}
+
+// Runs fn on `threads` jobs, job 0 on the calling thread
+static void run_jobs(void* (*fn)(void*), Job* jobs, int threads) {
+    pthread_t ids[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+    for (int i = 1; i < threads; i++) {
+        started[i] = pthread_create(&ids[i], NULL, fn, &jobs[i]) == 0;
+        if (!started[i]) fn(&jobs[i]);
+    }
+    fn(&jobs[0]);
+    for (int i = 1; i < threads; i++) {
+        if (started[i]) pthread_join(ids[i], NULL);
+    }
+}
+
+/* --- DRIVER --- */
+int lex_parallel(TokenBuffer* buffer, const Source* source, int threads) {
+    size_t length = source->length;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads > (int)(length / MIN_CHUNK_BYTES)) threads = (int)(length / MIN_CHUNK_BYTES);
+    if (threads < 1) threads = 1;
+
+    Region regions[MAX_THREADS];
+    Chunk chunks[MAX_THREADS];
+    Job jobs[MAX_THREADS];
+    size_t out_offset[MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+
+    // Structural pre-pass, one region per thread
+    for (int i = 0; i < threads; i++) {
+        regions[i].input = (const unsigned char*)source->data;
+        regions[i].begin = length / threads * i;
+        regions[i].end = i + 1 == threads ? length : length / threads * (i + 1);
+        regions[i].all_entries = i > 0;
+    }
+    for (int i = 0; i < threads; i++) {
+        jobs[i] = (Job){regions, chunks, NULL, out_offset, threads, threads, i};
+    }
+    if (threads > 1) run_jobs(prepass_job, jobs, threads);
+
+    // Chain the region summaries to pick one boundary per region
+    size_t start[MAX_THREADS];
+    int chunk_count = 0;
+    unsigned char state = P_CODE;
+    start[0] = 0;
+    for (int i = 1; i < threads; i++) {
+        state = regions[i - 1].exit[state];
+        size_t boundary = regions[i].first_safe[state];
+        if (boundary != SIZE_MAX) {
+            chunks[chunk_count++].end = boundary;
+            start[chunk_count] = boundary;
+        }
+    }
+    chunks[chunk_count++].end = length + 1;
+
+    for (int i = 0; i < chunk_count; i++) {
+        lexer_init(&chunks[i].lexer, source);
+        chunks[i].lexer.pos = (int)start[i];
+    }
+    for (int i = 0; i < chunk_count; i++) {
+        jobs[i] = (Job){regions, chunks, NULL, out_offset, chunk_count, chunk_count, i};
+    }
+    run_jobs(lex_job, jobs, chunk_count);
+
+    // Stitch: keep a chunk when it agrees with the previous chunk at the seam, re-lex it otherwise
+    size_t total = 0;
+    int failed = 0;
+    int used = chunk_count;     // Chunks up to the one that lexed TOKEN_EOF
+    for (int i = 0; i < used; i++) {
+        Chunk* chunk = &chunks[i];
+        if (i > 0) {
+            Chunk* previous = &chunks[i - 1];
+            Token expected = previous->peek;
+            int agrees = chunk->first.type == expected.type && chunk->first.error == expected.error
+                && chunk->first.offset == expected.offset && chunk->first.length == expected.length
+                && chunk->first_pos == previous->lexer.pos
+                && chunk->first_last_token_type == previous->lexer.last_token_type;
+            if (!agrees) {
+                // Carry on from the previous chunk's real state
+                chunk->lexer = previous->lexer;
+                chunk->count = 0;
+                chunk->failed = 0;
+                chunk_lex_from(chunk, expected);
+            }
+        }
+        failed |= chunk->failed;
+        out_offset[i] = total;
+        total += chunk->count;
+        if (chunk_reached_eof(chunk)) used = i + 1;
+    }
+
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->source = source;
+    int ok = !failed && token_buffer_reserve(buffer, total);
+    if (ok) {
+        buffer->count = total;
+        for (int i = 0; i < used; i++) {
+            jobs[i] = (Job){regions, chunks, buffer, out_offset, used, used, i};
+        }
+        run_jobs(copy_job, jobs, used);
+    } else {
+        token_buffer_free(buffer);
+    }
+
+    for (int i = 0; i < chunk_count; i++) free(chunks[i].tokens);
+    return ok;
+}
@@ -0,0 +1,387 @@
+/* scan.c */
+#include <stdint.h>
+#include "../../include/scan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// What a kernel is looking for
+enum {
+    K_WHITESPACE,
+    K_LINE_END,
+    K_COMMENT_END,
+    K_IDENTIFIER,
+    K_STRING,
+    K_STRUCTURAL
+};
+
+/* --- SCALAR KERNELS (fallback, one byte per step) --- */
+static size_t scalar_whitespace(const char* input, size_t pos) {
+    while (1) {
+        char c = input[pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return pos;
+        pos++;
+    }
+}
+
+static size_t scalar_line_end(const char* input, size_t pos) {
+    while (input[pos] != '\n' && input[pos] != '\0') pos++;
+    return pos;
+}
+
+static size_t scalar_comment_end(const char* input, size_t pos) {
+    while (input[pos] != '\0' && !(input[pos] == '*' && input[pos + 1] == '/')) pos++;
+    return pos;
+}
+
+static size_t scalar_identifier(const char* input, size_t pos) {
+    while (1) {
+        char c = input[pos];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+            return pos;
+        }
+        pos++;
+    }
+}
+
+static size_t scalar_string(const char* input, size_t pos) {
+    while (input[pos] != '"' && input[pos] != '\\' && input[pos] != '\0') pos++;
+    return pos;
+}
+
+static uint64_t scalar_structural_mask(const char* input, size_t pos) {
+    size_t width = 64 - ((uintptr_t)(input + pos) & 63);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < width; i++) {
+        char c = input[pos + i];
+        if (c == '\n' || c == '"' || c == '\'' || c == '#' || c == '/' || c == '*' || c == '\\' || c == '\0') {
+            mask |= 1ull << i;
+            if (c == '\0') break;
+        }
+    }
+    return mask;
+}
+
+#ifdef SCAN_X86
+/* --- SIMD KERNELS ---
+ * Loads are aligned to the vector width so a block never crosses into the page after the
+ * terminating NUL, and bytes before the start offset are masked off. Every stop set contains
+ * NUL, so no kernel reads past the block holding the end of input. */
+
+// The aligned over-read is intentional, so AddressSanitizer is told to leave these loads alone
+#define SCAN_OVERREAD __attribute__((no_sanitize_address))
+
+#define SIMD_FIND_BODY(WIDTH, VEC, LOAD, STOP_MASK)                                       \
+    const char* block = input + pos - ((uintptr_t)(input + pos) & (WIDTH - 1));         \
+    uint64_t live = ~0ull << ((uintptr_t)(input + pos) & (WIDTH - 1));                   \
+    while (1) {                                                                          \
+        VEC v = LOAD((const VEC*)block);                                                 \
+        uint32_t stop = (uint32_t)(STOP_MASK(v, kind) & live);                           \
+        if (stop) {                                                                      \
+            int bit = __builtin_ctz(stop);                                               \
+            size_t at = (size_t)(block - input) + bit;                                   \
+            if (kind == K_COMMENT_END && input[at] == '*' && input[at + 1] != '/') {     \
+                /* a lone '*', keep going in the same block */                           \
+                live = ~0ull << (bit + 1);                                               \
+                continue;                                                                \
+            }                                                                            \
+            return at;                                                                   \
+        }                                                                                \
+        block += WIDTH;                                                                  \
+        live = ~0ull;                                                                    \
+    }
+
+/* SSE2, 16 bytes per step */
+__attribute__((target("sse2"), always_inline))
+static inline __m128i sse2_in_range(__m128i v, char lo, char span) {
+    // unsigned (v - lo) <= span
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(span)), t);
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline uint64_t sse2_stop_mask(__m128i v, int kind) {
+    __m128i hit;
+    switch (kind) {
+        case K_WHITESPACE:
+            hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+            return ~(uint32_t)_mm_movemask_epi8(hit) & 0xFFFFu;
+        case K_LINE_END:
+            hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+            return (uint32_t)_mm_movemask_epi8(hit);
+        case K_COMMENT_END:
+            hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+            return (uint32_t)_mm_movemask_epi8(hit);
+        case K_IDENTIFIER:
+            hit = _mm_or_si128(_mm_or_si128(sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25),
+                                            sse2_in_range(v, '0', 9)),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+            return ~(uint32_t)_mm_movemask_epi8(hit) & 0xFFFFu;
+        case K_STRING:
+            hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                               _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+            return (uint32_t)_mm_movemask_epi8(hit);
+        default: // K_STRUCTURAL
+            hit = _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))),
+                                            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\'')),
+                                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('#')))),
+                               _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('*'))),
+                                            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                                                         _mm_cmpeq_epi8(v, _mm_setzero_si128()))));
+            return (uint32_t)_mm_movemask_epi8(hit);
+    }
+}
+
+__attribute__((target("sse2"), always_inline)) SCAN_OVERREAD
+static inline size_t sse2_find(const char* input, size_t pos, int kind) {
+    SIMD_FIND_BODY(16, __m128i, _mm_load_si128, sse2_stop_mask)
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static size_t sse2_whitespace(const char* input, size_t pos) {
+    return sse2_find(input, pos, K_WHITESPACE);
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static size_t sse2_line_end(const char* input, size_t pos) {
+    return sse2_find(input, pos, K_LINE_END);
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static size_t sse2_comment_end(const char* input, size_t pos) {
+    return sse2_find(input, pos, K_COMMENT_END);
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static size_t sse2_identifier(const char* input, size_t pos) {
+    return sse2_find(input, pos, K_IDENTIFIER);
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static size_t sse2_string(const char* input, size_t pos) {
+    return sse2_find(input, pos, K_STRING);
+}
+
+__attribute__((target("sse2"))) SCAN_OVERREAD
+static uint64_t sse2_structural_mask(const char* input, size_t pos) {
+    const char* block = input + pos - ((uintptr_t)(input + pos) & 63);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        mask |= sse2_stop_mask(_mm_load_si128((const __m128i*)(block + 16 * i)), K_STRUCTURAL) << (16 * i);
+    }
+    return mask >> ((uintptr_t)(input + pos) & 63);
+}
+
+/* AVX2, 32 bytes per step */
+__attribute__((target("avx2"), always_inline))
+static inline __m256i avx2_in_range(__m256i v, char lo, char span) {
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(span)), t);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline uint64_t avx2_stop_mask(__m256i v, int kind) {
+    __m256i hit;
+    switch (kind) {
+        case K_WHITESPACE:
+            hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+            return ~(uint32_t)_mm256_movemask_epi8(hit);
+        case K_LINE_END:
+            hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                  _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+            return (uint32_t)_mm256_movemask_epi8(hit);
+        case K_COMMENT_END:
+            hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')),
+                                  _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+            return (uint32_t)_mm256_movemask_epi8(hit);
+        case K_IDENTIFIER:
+            hit = _mm256_or_si256(_mm256_or_si256(avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25),
+                                                  avx2_in_range(v, '0', 9)),
+                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+            return ~(uint32_t)_mm256_movemask_epi8(hit);
+        case K_STRING:
+            hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                                  _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+            return (uint32_t)_mm256_movemask_epi8(hit);
+        default: // K_STRUCTURAL
+            hit = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')),
+                                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('#')))),
+                                  _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')),
+                                                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'))),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+                                                                  _mm256_cmpeq_epi8(v, _mm256_setzero_si256()))));
+            return (uint32_t)_mm256_movemask_epi8(hit);
+    }
+}
+
+__attribute__((target("avx2"), always_inline)) SCAN_OVERREAD
+static inline size_t avx2_find(const char* input, size_t pos, int kind) {
+    SIMD_FIND_BODY(32, __m256i, _mm256_load_si256, avx2_stop_mask)
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static size_t avx2_whitespace(const char* input, size_t pos) {
+    return avx2_find(input, pos, K_WHITESPACE);
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static size_t avx2_line_end(const char* input, size_t pos) {
+    return avx2_find(input, pos, K_LINE_END);
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static size_t avx2_comment_end(const char* input, size_t pos) {
+    return avx2_find(input, pos, K_COMMENT_END);
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static size_t avx2_identifier(const char* input, size_t pos) {
+    return avx2_find(input, pos, K_IDENTIFIER);
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static size_t avx2_string(const char* input, size_t pos) {
+    return avx2_find(input, pos, K_STRING);
+}
+
+__attribute__((target("avx2"))) SCAN_OVERREAD
+static uint64_t avx2_structural_mask(const char* input, size_t pos) {
+    const char* block = input + pos - ((uintptr_t)(input + pos) & 63);
+    uint64_t mask = 0;
+    for (int i = 0; i < 2; i++) {
+        mask |= avx2_stop_mask(_mm256_load_si256((const __m256i*)(block + 32 * i)), K_STRUCTURAL) << (32 * i);
+    }
+    return mask >> ((uintptr_t)(input + pos) & 63);
+}
+#endif /* SCAN_X86 */
+
+/* --- RUNTIME SELECTION --- */
+// The kernel pointers start out at resolvers that run CPUID once and install the best kernels.
+// scan_init installs them at load time, before main and before any lexing thread can start, so
+// the pointers are only read while threads lex. scan_select must not be called while they do.
+static size_t resolve_whitespace(const char* input, size_t pos);
+static size_t resolve_line_end(const char* input, size_t pos);
+static size_t resolve_comment_end(const char* input, size_t pos);
+static size_t resolve_identifier(const char* input, size_t pos);
+static size_t resolve_string(const char* input, size_t pos);
+static uint64_t resolve_structural_mask(const char* input, size_t pos);
+
+size_t (*scan_whitespace)(const char* input, size_t pos) = resolve_whitespace;
+size_t (*scan_line_end)(const char* input, size_t pos) = resolve_line_end;
+size_t (*scan_comment_end)(const char* input, size_t pos) = resolve_comment_end;
+size_t (*scan_identifier)(const char* input, size_t pos) = resolve_identifier;
+size_t (*scan_string)(const char* input, size_t pos) = resolve_string;
+uint64_t (*scan_structural_mask)(const char* input, size_t pos) = resolve_structural_mask;
+
+static ScanLevel selected_level = SCAN_SCALAR;
+
+// Best level this CPU supports
+static ScanLevel detect_level(void) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SCAN_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SCAN_SSE2;
+#endif
+    return SCAN_SCALAR;
+}
+
+ScanLevel scan_select(ScanLevel level) {
+    ScanLevel best = detect_level();
+    if (level > best) level = best;
+    switch (level) {
+#ifdef SCAN_X86
+        case SCAN_AVX2:
+            scan_whitespace = avx2_whitespace;
+            scan_line_end = avx2_line_end;
+            scan_comment_end = avx2_comment_end;
+            scan_identifier = avx2_identifier;
+            scan_string = avx2_string;
+            scan_structural_mask = avx2_structural_mask;
+            break;
+        case SCAN_SSE2:
+            scan_whitespace = sse2_whitespace;
+            scan_line_end = sse2_line_end;
+            scan_comment_end = sse2_comment_end;
+            scan_identifier = sse2_identifier;
+            scan_string = sse2_string;
+            scan_structural_mask = sse2_structural_mask;
+            break;
+#endif
+        default:
+            level = SCAN_SCALAR;
+            scan_whitespace = scalar_whitespace;
+            scan_line_end = scalar_line_end;
+            scan_comment_end = scalar_comment_end;
+            scan_identifier = scalar_identifier;
+            scan_string = scalar_string;
+            scan_structural_mask = scalar_structural_mask;
+    }
+    selected_level = level;
+    return level;
+}
+
+__attribute__((constructor))
+static void scan_init(void) {
+    if (scan_whitespace == resolve_whitespace) {
+        scan_select(SCAN_AVX2);
+    }
+}
+
+ScanLevel scan_level(void) {
+    if (scan_whitespace == resolve_whitespace) {
+        scan_select(SCAN_AVX2);
+    }
+    return selected_level;
+}
+
+const char* scan_level_name(ScanLevel level) {
+    switch (level) {
+        case SCAN_AVX2: return "avx2";
+        case SCAN_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+static size_t resolve_whitespace(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_whitespace(input, pos);
+}
+
+static size_t resolve_line_end(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_line_end(input, pos);
+}
+
+static size_t resolve_comment_end(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_comment_end(input, pos);
+}
+
+static size_t resolve_identifier(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_identifier(input, pos);
+}
+
+static size_t resolve_string(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_string(input, pos);
+}
+
+static uint64_t resolve_structural_mask(const char* input, size_t pos) {
+    scan_select(SCAN_AVX2);
+    return scan_structural_mask(input, pos);
+}
@@ -0,0 +1,102 @@
+/* token_buffer.c */
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/tokens.h"
+#include "../../include/lexer.h"
+
+/* Struct-of-arrays token stream.
+ * The parser walks tokens by index, so each field lives in its own array: matching on types
+ * touches one byte per token and peeking ahead is an array read. Tokens keep no line, the line and
+ * column of a token come from the source line index when a diagnostic needs them.
+ * Identifiers, literals and operators are interned as they are stored, so later passes compare
+ * names by atom and never go back to the source text. */
+
+int token_buffer_reserve(TokenBuffer *buffer, size_t capacity) {
+    if (capacity <= buffer->capacity) return 1;
+    uint8_t *types = realloc(buffer->types, capacity * sizeof(uint8_t));
+    if (types) buffer->types = types;
+    uint8_t *errors = realloc(buffer->errors, capacity * sizeof(uint8_t));
+    if (errors) buffer->errors = errors;
+    uint32_t *offsets = realloc(buffer->offsets, capacity * sizeof(uint32_t));
+    if (offsets) buffer->offsets = offsets;
+    uint32_t *lengths = realloc(buffer->lengths, capacity * sizeof(uint32_t));
+    if (lengths) buffer->lengths = lengths;
+    Atom *atoms = realloc(buffer->atoms, capacity * sizeof(Atom));
+    if (atoms) buffer->atoms = atoms;
+    if (!types || !errors || !offsets || !lengths || !atoms) return 0;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+// Tokens whose text follows from their type (keywords and delimiters) are not worth an atom
+Atom token_atom(const char *source, Token token) {
+    switch (token.type) {
+        case TOKEN_IDENTIFIER:
+        case TOKEN_NUMBER:
+        case TOKEN_STRING_LITERAL:
+        case TOKEN_CHAR_LITERAL:
+        case TOKEN_PLUS ... TOKEN_OR:
+        case TOKEN_EQUALS:
+        case TOKEN_EQUAL_EQUAL ... TOKEN_GREATER_EQUAL:
+        case TOKEN_SPECIAL_CHARACTER:
+        case TOKEN_ERROR:
+            return intern(source + token.offset, token.length);
+        default:
+            return ATOM_NONE;
+    }
+}
+
+static void token_buffer_start(TokenBuffer *buffer, const Source *source) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->source = source;
+}
+
+int lex_all(TokenBuffer *buffer, const Source *source) {
+    token_buffer_start(buffer, source);
+    // Around one token per 4 bytes of source
+    if (!token_buffer_reserve(buffer, source->length / 4 + 16)) {
+        token_buffer_free(buffer);
+        return 0;
+    }
+
+    LexerState lexer;
+    lexer_init(&lexer, source);
+    while (1) {
+        Token token = get_next_token(&lexer);
+        if (buffer->count == buffer->capacity && !token_buffer_reserve(buffer, buffer->capacity * 2)) {
+            token_buffer_free(buffer);
+            return 0;
+        }
+        size_t i = buffer->count++;
+        buffer->types[i] = token.type;
+        buffer->errors[i] = token.error;
+        buffer->offsets[i] = token.offset;
+        buffer->lengths[i] = token.length;
+        buffer->atoms[i] = token_atom(source->data, token);
+        if (token.type == TOKEN_EOF) return 1;
+    }
+}
+
+SourceLocation token_location(const TokenBuffer *buffer, size_t index) {
+    if (index >= buffer->count) index = buffer->count - 1;
+    return source_location(buffer->source, buffer->offsets[index]);
+}
+
+Token token_at(const TokenBuffer *buffer, size_t index) {
+    if (index >= buffer->count) index = buffer->count - 1;
+    Token token = {.type = buffer->types[index], .error = buffer->errors[index],
+                   .offset = buffer->offsets[index], .length = buffer->lengths[index]};
+    return token;
+}
+
+void token_buffer_free(TokenBuffer *buffer) {
+    free(buffer->types);
+    free(buffer->errors);
+    free(buffer->offsets);
+    free(buffer->lengths);
+    free(buffer->atoms);
+    buffer->types = buffer->errors = NULL;
+    buffer->offsets = buffer->lengths = NULL;
+    buffer->atoms = NULL;
+    buffer->count = buffer->capacity = 0;
+}
@@ -0,0 +1,127 @@
+/* main.c */
+#include <stdio.h>
+#include <string.h>
+#include "../include/source.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/ast_cache.h"
+#include "../include/semantic.h"
+#include "../include/diagnostics.h"
+
+static const char* inputs[] = {
+    "../phase2-w25/test/input_semantic_error.txt",
+    "../phase2-w25/test/input_valid.txt",
+};
+
+// Lex, parse and check one file, its diagnostics are emitted once at the end
+// With cache set the tree is loaded from path.ast when that holds this source, and saved there otherwise
+static int compile_file(const char* path, DiagSink* diagnostics, DiagFormat format, int cache) {
+    int verbose = format == DIAG_TEXT && diagnostics->level >= LOG_WARNING;
+    // get file
+    Source source;
+    if (!source_load(&source, path)) {
+        return 0;
+    }
+
+    // Lexical analysis and parsing, skipped when the cache holds the tree of this source
+    if (verbose) printf("Parsing input:\n%s\n\n", source.data);
+    char cache_path[4096];
+    snprintf(cache_path, sizeof(cache_path), "%s.ast", path);
+    AstCache cached;
+    int warm = cache && ast_cache_load(&cached, &source, cache_path);
+    TokenBuffer tokens;
+    ParserState parser;
+    const Ast* tree;
+    NodeId ast;
+    size_t syntax_errors = 0;
+    if (warm) {
+        tree = &cached.ast;
+        ast = cached.root;
+        report_lexical_errors(&cached.tokens, diagnostics);
+    } else {
+        if (!lex_all(&tokens, &source)) {
+            source_free(&source);
+            return 0;
+        }
+        parser_init(&parser, &tokens);
+        ast = parse(&parser);
+        tree = &parser.ast;
+        // Trees with syntax errors are not saved, a failed write only means the next run parses again
+        if (cache) ast_cache_write(&parser, ast, cache_path);
+        report_lexical_errors(&tokens, diagnostics);
+        report_parse_errors(&parser, diagnostics);
+        syntax_errors = parser.diagnostic_count;
+    }
+    if (verbose) {
+        printf(warm ? "AST loaded from %s. Printing...\n\n" : "AST created. Printing...\n\n", cache_path);
+        print_ast(tree, ast, 0);
+    }
+
+    // Semantic analysis, only run on a tree without syntax errors
+    const char* summary;
+    char failed[64];
+    if (syntax_errors) {
+        snprintf(failed, sizeof(failed), "Parsing failed. %zu syntax errors found.", syntax_errors);
+        summary = failed;
+    } else if (analyze_semantics(tree, ast, diagnostics)) {
+        summary = "Semantic analysis successful. No errors found.";
+    } else {
+        summary = "Semantic analysis failed. Errors detected.";
+    }
+
+    if (format == DIAG_JSON) {
+        printf("{\"file\": \"%s\", \"diagnostics\": ", path);
+        diag_emit(diagnostics, stdout, DIAG_JSON);
+        printf("}");
+    } else {
+        diag_emit(diagnostics, stdout, DIAG_TEXT);
+        printf("%s\n", summary);
+    }
+    diag_clear(diagnostics);
+
+    // Free Vars
+    if (warm) {
+        ast_cache_free(&cached);
+    } else {
+        parser_free(&parser);
+        token_buffer_free(&tokens);
+    }
+    source_free(&source);
+    return 1;
+}
+
+// --trace prints every step of the checker, --quiet only the errors, --json the diagnostics as JSON
+// --cache keeps the tree of each input next to it and skips lexing and parsing while the input is unchanged
+int main(int argc, char** argv) {
+    LogLevel level = LOG_WARNING;
+    DiagFormat format = DIAG_TEXT;
+    int cache = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) {
+            level = LOG_TRACE;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            level = LOG_ERROR;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = DIAG_JSON;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            cache = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--trace | --quiet] [--json] [--cache]\n", argv[0]);
+            return 1;
+        }
+    }
+    // Traces go to stdout as they happen, so they would break the JSON
+    if (format == DIAG_JSON && level == LOG_TRACE) level = LOG_WARNING;
+
+    DiagSink diagnostics;
+    diag_init(&diagnostics, level);
+    int ok = 1;
+    if (format == DIAG_JSON) printf("[");
+    for (size_t i = 0; ok && i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        if (format == DIAG_JSON) printf(i ? ",\n" : "\n");
+        ok = compile_file(inputs[i], &diagnostics, format, cache);
+    }
+    if (format == DIAG_JSON) printf("\n]\n");
+    diag_free(&diagnostics);
+    return ok ? 0 : 1;
+}
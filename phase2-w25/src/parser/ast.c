@@ -0,0 +1,185 @@
+/* ast.c */
+#include <stdlib.h>
+#include <stdint.h>
+#include "../../include/ast.h"
+
+#define AST_MIN_CAPACITY 256
+
+void ast_init(Ast* ast, const TokenBuffer* tokens) {
+    ast->tokens = tokens;
+    ast->kind = NULL;
+    ast->token = NULL;
+    ast->left = NULL;
+    ast->right = NULL;
+    ast->count = 0;
+    ast->capacity = 0;
+    ast->children = NULL;
+    ast->child_count = 0;
+    ast->child_capacity = 0;
+    ast->allocations = 0;
+    ast->shared = 0;
+}
+
+// Grows every array to capacity, a failed realloc leaves the arrays it already grew in place
+static int ast_reserve_nodes(Ast* ast, size_t capacity) {
+    if (capacity > UINT32_MAX) return 0;
+    uint8_t* kind = realloc(ast->kind, capacity * sizeof(uint8_t));
+    if (!kind) return 0;
+    ast->kind = kind;
+    uint32_t* token = realloc(ast->token, capacity * sizeof(uint32_t));
+    if (!token) return 0;
+    ast->token = token;
+    NodeId* left = realloc(ast->left, capacity * sizeof(NodeId));
+    if (!left) return 0;
+    ast->left = left;
+    NodeId* right = realloc(ast->right, capacity * sizeof(NodeId));
+    if (!right) return 0;
+    ast->right = right;
+    ast->capacity = capacity;
+    ast->allocations++;
+    return 1;
+}
+
+NodeId ast_add(Ast* ast, ASTNodeType kind, size_t token) {
+    if (ast->count == ast->capacity) {
+        // Programs have fewer nodes than tokens, so sizing the first allocation from the buffer avoids regrowing
+        size_t capacity = ast->capacity ? ast->capacity * 2 : ast->tokens->count + 1;
+        if (capacity < AST_MIN_CAPACITY) capacity = AST_MIN_CAPACITY;
+        if (!ast_reserve_nodes(ast, capacity)) return NODE_NONE;
+    }
+    if (ast->count == 0) {
+        // Reserve the NODE_NONE slot
+        ast->kind[0] = AST_NULL;
+        ast->token[0] = 0;
+        ast->left[0] = NODE_NONE;
+        ast->right[0] = NODE_NONE;
+        ast->count = 1;
+    }
+    NodeId node = (NodeId)ast->count++;
+    ast->kind[node] = (uint8_t)kind;
+    ast->token[node] = (uint32_t)token;
+    ast->left[node] = NODE_NONE;
+    ast->right[node] = NODE_NONE;
+    return node;
+}
+
+static int ast_reserve_children(Ast* ast, size_t capacity) {
+    if (capacity > UINT32_MAX) return 0;
+    NodeId* grown = realloc(ast->children, capacity * sizeof(NodeId));
+    if (!grown) return 0;
+    ast->children = grown;
+    ast->child_capacity = capacity;
+    ast->allocations++;
+    return 1;
+}
+
+int ast_reserve(Ast* ast, size_t nodes, size_t children) {
+    if (nodes > ast->capacity && !ast_reserve_nodes(ast, nodes)) return 0;
+    if (children > ast->child_capacity && !ast_reserve_children(ast, children)) return 0;
+    return 1;
+}
+
+int ast_set_children(Ast* ast, NodeId node, const NodeId* children, size_t count) {
+    if (ast->child_count + count > ast->child_capacity) {
+        // Every statement takes at least two tokens
+        size_t capacity = ast->child_capacity ? ast->child_capacity * 2 : ast->tokens->count / 2 + 1;
+        if (capacity < AST_MIN_CAPACITY) capacity = AST_MIN_CAPACITY;
+        while (capacity < ast->child_count + count) capacity *= 2;
+        if (!ast_reserve_children(ast, capacity)) return 0;
+    }
+    for (size_t i = 0; i < count; i++) ast->children[ast->child_count + i] = children[i];
+    ast->left[node] = (NodeId)ast->child_count;
+    ast->right[node] = (NodeId)count;
+    ast->child_count += count;
+    return 1;
+}
+
+void ast_copy(Ast* ast, NodeId node, size_t child, const Ast* from) {
+    // Nodes of from move up by node - 1 (its slot 1 lands on node), statement lists by child
+    NodeId shift = node - 1;
+    for (NodeId i = 1; i < from->count; i++) {
+        NodeId at = i + shift;
+        ast->kind[at] = from->kind[i];
+        ast->token[at] = from->token[i];
+        if (ast_is_sequence(from, i)) {
+            ast->left[at] = from->left[i] + (NodeId)child;
+            ast->right[at] = from->right[i];
+        } else {
+            ast->left[at] = from->left[i] ? from->left[i] + shift : NODE_NONE;
+            ast->right[at] = from->right[i] ? from->right[i] + shift : NODE_NONE;
+        }
+    }
+    for (size_t i = 0; i < from->child_count; i++) ast->children[child + i] = from->children[i] + shift;
+}
+
+void ast_reset(Ast* ast) {
+    ast->count = 0;
+    ast->child_count = 0;
+    ast->shared = 0;
+}
+
+void ast_free(Ast* ast) {
+    free(ast->kind);
+    free(ast->token);
+    free(ast->left);
+    free(ast->right);
+    free(ast->children);
+    ast_init(ast, ast->tokens);
+}
+
+size_t ast_memory(const Ast* ast) {
+    return ast->capacity * (sizeof(uint8_t) + sizeof(uint32_t) + 2 * sizeof(NodeId))
+         + ast->child_capacity * sizeof(NodeId);
+}
+
+/* --- TRAVERSAL --- */
+static void ast_walk_push(AstWalk* walk, NodeId node, int depth) {
+    if (node == NODE_NONE || walk->failed) return;
+    if (walk->count == walk->capacity) {
+        size_t capacity = walk->capacity ? walk->capacity * 2 : 64;
+        AstWalkEntry* grown = realloc(walk->stack, capacity * sizeof(AstWalkEntry));
+        if (!grown) {
+            walk->failed = 1;
+            return;
+        }
+        walk->stack = grown;
+        walk->capacity = capacity;
+    }
+    walk->stack[walk->count].node = node;
+    walk->stack[walk->count].depth = depth;
+    walk->count++;
+}
+
+void ast_walk_begin(AstWalk* walk, const Ast* ast, NodeId root, int depth) {
+    walk->ast = ast;
+    walk->stack = NULL;
+    walk->count = 0;
+    walk->capacity = 0;
+    walk->failed = 0;
+    ast_walk_push(walk, root, depth);
+}
+
+int ast_walk_next(AstWalk* walk, NodeId* node, int* depth) {
+    if (walk->count == 0 || walk->failed) return 0;
+    AstWalkEntry entry = walk->stack[--walk->count];
+    const Ast* ast = walk->ast;
+    // Children are pushed last first so they pop in order
+    if (ast_is_sequence(ast, entry.node)) {
+        for (uint32_t i = ast_child_count(ast, entry.node); i > 0; i--) {
+            ast_walk_push(walk, ast_child(ast, entry.node, i - 1), entry.depth + 1);
+        }
+    } else {
+        ast_walk_push(walk, ast_right(ast, entry.node), entry.depth + 1);
+        ast_walk_push(walk, ast_left(ast, entry.node), entry.depth + 1);
+    }
+    *node = entry.node;
+    if (depth) *depth = entry.depth;
+    return 1;
+}
+
+void ast_walk_end(AstWalk* walk) {
+    free(walk->stack);
+    walk->stack = NULL;
+    walk->count = 0;
+    walk->capacity = 0;
+}
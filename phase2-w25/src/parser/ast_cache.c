@@ -0,0 +1,356 @@
+/* ast_cache.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/ast_cache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CACHE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* File layout, native byte order:
+ *   CacheHeader
+ *   one section per array, each starting on an 8 byte boundary:
+ *   token types, errors, offsets, lengths, atoms (string numbers, 0 for none),
+ *   node kinds, tokens, lefts, rights, statement lists,
+ *   string offsets (one per string counting string 0, then the end), string hashes (intern_hash of each, so
+ *   loading does not hash the text again) and the string bytes, each NUL-terminated
+ * Sequence nodes hold positions in the statement lists and other nodes hold node numbers, as in memory, so
+ * nothing in the file depends on where it is mapped. */
+
+#define CACHE_MAGIC "SPASTC\r\n"    // The line ending catches files copied in text mode
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_SHARED 1u                 // Header flag of a hash-consed tree
+
+enum {
+    SECTION_TOKEN_TYPES,
+    SECTION_TOKEN_ERRORS,
+    SECTION_TOKEN_OFFSETS,
+    SECTION_TOKEN_LENGTHS,
+    SECTION_TOKEN_ATOMS,
+    SECTION_NODE_KINDS,
+    SECTION_NODE_TOKENS,
+    SECTION_NODE_LEFTS,
+    SECTION_NODE_RIGHTS,
+    SECTION_CHILDREN,
+    SECTION_STRING_OFFSETS,
+    SECTION_STRING_HASHES,
+    SECTION_STRINGS,
+    SECTION_COUNT
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;        // CACHE_BYTE_ORDER as the writer stored it
+    uint64_t source_hash;
+    uint64_t source_length;
+    uint32_t root;
+    uint32_t token_count;
+    uint32_t node_count;        // Counting the NODE_NONE slot
+    uint32_t child_count;
+    uint32_t string_count;      // Distinct token texts, numbered from 1
+    uint32_t flags;             // CACHE_SHARED or 0
+    uint32_t string_hash;       // intern_hash of the magic, the stored hashes are only used under the same one
+    uint32_t reserved;          // 0
+    uint64_t offsets[SECTION_COUNT];
+    uint64_t sizes[SECTION_COUNT];
+} CacheHeader;
+
+// Bytes of every section for the counts in header, the strings section is sized by the writer
+static void section_sizes(const CacheHeader* header, uint64_t* sizes) {
+    sizes[SECTION_TOKEN_TYPES] = header->token_count * (uint64_t)sizeof(uint8_t);
+    sizes[SECTION_TOKEN_ERRORS] = header->token_count * (uint64_t)sizeof(uint8_t);
+    sizes[SECTION_TOKEN_OFFSETS] = header->token_count * (uint64_t)sizeof(uint32_t);
+    sizes[SECTION_TOKEN_LENGTHS] = header->token_count * (uint64_t)sizeof(uint32_t);
+    sizes[SECTION_TOKEN_ATOMS] = header->token_count * (uint64_t)sizeof(uint32_t);
+    sizes[SECTION_NODE_KINDS] = header->node_count * (uint64_t)sizeof(uint8_t);
+    sizes[SECTION_NODE_TOKENS] = header->node_count * (uint64_t)sizeof(uint32_t);
+    sizes[SECTION_NODE_LEFTS] = header->node_count * (uint64_t)sizeof(NodeId);
+    sizes[SECTION_NODE_RIGHTS] = header->node_count * (uint64_t)sizeof(NodeId);
+    sizes[SECTION_CHILDREN] = header->child_count * (uint64_t)sizeof(NodeId);
+    sizes[SECTION_STRING_OFFSETS] = ((uint64_t)header->string_count + 2) * sizeof(uint32_t);
+    sizes[SECTION_STRING_HASHES] = ((uint64_t)header->string_count + 1) * sizeof(uint32_t);
+}
+
+/* --- WRITING --- */
+// Numbers the distinct atoms of the tokens in order of first use, with an open-addressing table keyed by atom
+typedef struct {
+    uint32_t* numbers;          // String number of every token, 0 for tokens without an atom
+    Atom* strings;              // Atom of every string number, strings[0] is ATOM_NONE
+    uint32_t count;             // Strings numbered, counting 0
+    uint64_t bytes;             // Their text with terminators
+} StringTable;
+
+static int string_table_build(StringTable* table, const TokenBuffer* tokens) {
+    size_t slots = 64;
+    while (slots < tokens->count * 2) slots *= 2;
+    uint64_t* keys = calloc(slots, sizeof(uint64_t)); // atom << 32 | number, 0 for an empty slot
+    table->numbers = malloc(tokens->count * sizeof(uint32_t));
+    table->strings = malloc((tokens->count + 1) * sizeof(Atom));
+    if (!keys || !table->numbers || !table->strings) {
+        free(keys);
+        free(table->numbers);
+        free(table->strings);
+        return 0;
+    }
+    table->strings[0] = ATOM_NONE;
+    table->count = 1;
+    table->bytes = 1;
+    for (size_t i = 0; i < tokens->count; i++) {
+        Atom atom = tokens->atoms[i];
+        if (atom == ATOM_NONE) {
+            table->numbers[i] = 0;
+            continue;
+        }
+        size_t slot = (atom * 2654435761u) & (slots - 1);
+        while (keys[slot] && (Atom)(keys[slot] >> 32) != atom) slot = (slot + 1) & (slots - 1);
+        if (!keys[slot]) {
+            keys[slot] = (uint64_t)atom << 32 | table->count;
+            table->strings[table->count++] = atom;
+            table->bytes += atom_length(atom) + 1;
+        }
+        table->numbers[i] = (uint32_t)keys[slot];
+    }
+    free(keys);
+    return 1;
+}
+
+// Zeros from the end of a section of size bytes to the next 8 byte boundary, returns 1 on success
+static int write_padding(FILE* file, uint64_t size) {
+    static const char padding[8];
+    size_t pad = (size_t)(-size & 7);
+    return !pad || fwrite(padding, 1, pad, file) == pad;
+}
+
+static int write_section(FILE* file, const void* data, uint64_t size) {
+    if (size && fwrite(data, 1, size, file) != size) return 0;
+    return write_padding(file, size);
+}
+
+static int write_strings(FILE* file, const StringTable* table, const uint64_t* sizes) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        if (fwrite(&offset, sizeof(offset), 1, file) != 1) return 0;
+        offset += (uint32_t)(i ? atom_length(table->strings[i]) + 1 : 1);
+    }
+    if (fwrite(&offset, sizeof(offset), 1, file) != 1 || !write_padding(file, sizes[SECTION_STRING_OFFSETS])) return 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        Atom atom = table->strings[i];
+        uint32_t hash = i ? intern_hash(atom_text(atom), atom_length(atom)) : 0;
+        if (fwrite(&hash, sizeof(hash), 1, file) != 1) return 0;
+    }
+    if (!write_padding(file, sizes[SECTION_STRING_HASHES])) return 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        const char* text = atom_text(table->strings[i]);
+        size_t length = i ? atom_length(table->strings[i]) + 1 : 1;
+        if (fwrite(text, 1, length, file) != length) return 0;
+    }
+    return write_padding(file, table->bytes);
+}
+
+int ast_cache_write(const ParserState* parser, NodeId root, const char* path) {
+    const Ast* ast = &parser->ast;
+    const TokenBuffer* tokens = ast->tokens;
+    if (parser->diagnostic_count || tokens->atom_map || tokens->count > UINT32_MAX) return 0;
+
+    StringTable table;
+    if (!string_table_build(&table, tokens)) {
+        printf("Memory allocation failed.\n");
+        return 0;
+    }
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = AST_CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.source_hash = source_hash(tokens->source);
+    header.source_length = tokens->source->length;
+    header.root = root;
+    header.token_count = (uint32_t)tokens->count;
+    header.node_count = (uint32_t)ast->count;
+    header.child_count = (uint32_t)ast->child_count;
+    header.flags = ast->shared ? CACHE_SHARED : 0;
+    header.string_count = table.count - 1;
+    header.string_hash = intern_hash(CACHE_MAGIC, sizeof(header.magic));
+    section_sizes(&header, header.sizes);
+    header.sizes[SECTION_STRINGS] = table.bytes;
+    uint64_t offset = (sizeof(CacheHeader) + 7) & ~(uint64_t)7;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        header.offsets[i] = offset;
+        offset += (header.sizes[i] + 7) & ~(uint64_t)7;
+    }
+
+    // Written whole under another name first, so a reader never maps half a file
+    size_t length = strlen(path);
+    char* temporary = malloc(length + 5);
+    if (!temporary) {
+        printf("Memory allocation failed.\n");
+        free(table.numbers);
+        free(table.strings);
+        return 0;
+    }
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+    FILE* file = fopen(temporary, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        ok = write_section(file, &header, sizeof(header))
+             && write_section(file, tokens->types, header.sizes[SECTION_TOKEN_TYPES])
+             && write_section(file, tokens->errors, header.sizes[SECTION_TOKEN_ERRORS])
+             && write_section(file, tokens->offsets, header.sizes[SECTION_TOKEN_OFFSETS])
+             && write_section(file, tokens->lengths, header.sizes[SECTION_TOKEN_LENGTHS])
+             && write_section(file, table.numbers, header.sizes[SECTION_TOKEN_ATOMS])
+             && write_section(file, ast->kind, header.sizes[SECTION_NODE_KINDS])
+             && write_section(file, ast->token, header.sizes[SECTION_NODE_TOKENS])
+             && write_section(file, ast->left, header.sizes[SECTION_NODE_LEFTS])
+             && write_section(file, ast->right, header.sizes[SECTION_NODE_RIGHTS])
+             && write_section(file, ast->children, header.sizes[SECTION_CHILDREN])
+             && write_strings(file, &table, header.sizes);
+        ok = fclose(file) == 0 && ok;
+        ok = ok && rename(temporary, path) == 0;
+        if (!ok) remove(temporary);
+    }
+    free(temporary);
+    free(table.numbers);
+    free(table.strings);
+    return ok;
+}
+
+/* --- LOADING --- */
+// Header fits the file and describes this source, every section lies inside the file at its expected size
+static int header_valid(const CacheHeader* header, size_t size, const Source* source) {
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != AST_CACHE_VERSION
+        || header->byte_order != CACHE_BYTE_ORDER || header->source_length != source->length
+        || header->string_hash != intern_hash(CACHE_MAGIC, sizeof(header->magic))
+        || header->root >= header->node_count || header->token_count == 0) {
+        return 0;
+    }
+    uint64_t sizes[SECTION_COUNT];
+    section_sizes(header, sizes);
+    sizes[SECTION_STRINGS] = header->sizes[SECTION_STRINGS];
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (header->sizes[i] != sizes[i] || header->offsets[i] % 8 != 0 || header->offsets[i] > size
+            || sizes[i] > size - header->offsets[i]) {
+            return 0;
+        }
+    }
+    // Hashing reads the whole source, so it comes after the cheap checks
+    return header->source_hash == source_hash(source);
+}
+
+static void cache_release(AstCache* cache) {
+#ifdef CACHE_MMAP
+    if (cache->mapped) {
+        munmap(cache->image, cache->size);
+        cache->image = NULL;
+        return;
+    }
+#endif
+    free(cache->image);
+    cache->image = NULL;
+}
+
+// Map the file read-only, or read it where there is no mmap
+static int cache_open(AstCache* cache, const char* path) {
+    cache->image = NULL;
+    cache->size = 0;
+    cache->mapped = 0;
+#ifdef CACHE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(CacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    cache->image = map;
+    cache->size = info.st_size;
+    cache->mapped = 1;
+    return 1;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    if (size < (long)sizeof(CacheHeader) || !(cache->image = malloc(size))) {
+        fclose(file);
+        return 0;
+    }
+    cache->size = fread(cache->image, 1, size, file);
+    fclose(file);
+    return cache->size == (size_t)size;
+#endif
+}
+
+int ast_cache_load(AstCache* cache, const Source* source, const char* path) {
+    cache->atoms = NULL;
+    if (!cache_open(cache, path)) return 0;
+    const char* image = cache->image;
+    const CacheHeader* header = (const CacheHeader*)image;
+    if (!header_valid(header, cache->size, source)) {
+        cache_release(cache);
+        return 0;
+    }
+
+    // Bind the string table to this process's atoms, with the hashes the writer stored
+    const uint32_t* string_offsets = (const uint32_t*)(image + header->offsets[SECTION_STRING_OFFSETS]);
+    const uint32_t* string_hashes = (const uint32_t*)(image + header->offsets[SECTION_STRING_HASHES]);
+    const char* strings = image + header->offsets[SECTION_STRINGS];
+    cache->atoms = malloc(((size_t)header->string_count + 1) * sizeof(Atom));
+    if (!cache->atoms) {
+        printf("Memory allocation failed.\n");
+        cache_release(cache);
+        return 0;
+    }
+    cache->atoms[0] = ATOM_NONE;
+    for (uint32_t i = 1; i <= header->string_count; i++) {
+        uint32_t start = string_offsets[i];
+        uint32_t end = string_offsets[i + 1];
+        if (start >= end || end > header->sizes[SECTION_STRINGS]
+            || (cache->atoms[i] = intern_hashed(strings + start, end - start - 1, string_hashes[i])) == ATOM_NONE) {
+            free(cache->atoms);
+            cache_release(cache);
+            return 0;
+        }
+    }
+
+    TokenBuffer* tokens = &cache->tokens;
+    memset(tokens, 0, sizeof(*tokens));
+    tokens->source = source;
+    tokens->types = (uint8_t*)(image + header->offsets[SECTION_TOKEN_TYPES]);
+    tokens->errors = (uint8_t*)(image + header->offsets[SECTION_TOKEN_ERRORS]);
+    tokens->offsets = (uint32_t*)(image + header->offsets[SECTION_TOKEN_OFFSETS]);
+    tokens->lengths = (uint32_t*)(image + header->offsets[SECTION_TOKEN_LENGTHS]);
+    tokens->atoms = (Atom*)(image + header->offsets[SECTION_TOKEN_ATOMS]);
+    tokens->atom_map = cache->atoms;
+    tokens->count = header->token_count;
+
+    Ast* ast = &cache->ast;
+    ast_init(ast, tokens);
+    ast->kind = (uint8_t*)(image + header->offsets[SECTION_NODE_KINDS]);
+    ast->token = (uint32_t*)(image + header->offsets[SECTION_NODE_TOKENS]);
+    ast->left = (NodeId*)(image + header->offsets[SECTION_NODE_LEFTS]);
+    ast->right = (NodeId*)(image + header->offsets[SECTION_NODE_RIGHTS]);
+    ast->count = header->node_count;
+    ast->children = (NodeId*)(image + header->offsets[SECTION_CHILDREN]);
+    ast->child_count = header->child_count;
+    ast->shared = (header->flags & CACHE_SHARED) != 0;
+    cache->root = header->root;
+    return 1;
+}
+
+void ast_cache_free(AstCache* cache) {
+    free(cache->atoms);
+    cache->atoms = NULL;
+    cache_release(cache);
+}
@@ -3,118 +3,116 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../../include/parser.h"
+#include "../../include/parser_internal.h"
 #include "../../include/lexer.h"
 #include "../../include/tokens.h"
 
-// Current token being processed
-static Token current_token;
-static int position = 0;
-static const char *source;
-static const int OPERATOR_TOKEN_MAX = 128; //arbitrary
-
 /* ---PARSER ERROR OUTPUTS FUNCTIONS--- */
-static void parse_error(ParseError error, Token token) {
-    printf("Parse Error at line %d: ", token.line);
-    switch (error) {
+static void report_parse_error(const ParserState *parser, const ParseDiagnostic *diagnostic, DiagSink *sink) {
+    Token token = token_at(parser->tokens, diagnostic->token);
+    SourceLocation location = token_location(parser->tokens, diagnostic->token);
+    const char *source = parser->tokens->source->data;
+    const char *format;
+    switch (diagnostic->error) {
         case PARSE_ERROR_UNEXPECTED_TOKEN:
-            printf("Unexpected token '%s' at position '%d'\n", token.lexeme, position);
+            format = "Unexpected token '%.*s'";
             break;
         case PARSE_ERROR_MISSING_SEMICOLON:
-            printf("Missing semicolon after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Missing semicolon after '%.*s'";
             break;
         case PARSE_ERROR_MISSING_IDENTIFIER:
-            printf("Expected identifier after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Expected identifier after '%.*s'";
             break;
         case PARSE_ERROR_MISSING_EQUALS:
-            printf("Expected '=' after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Expected '=' after '%.*s'";
             break;
         case PARSE_ERROR_INVALID_EXPRESSION:
-            printf("Invalid expression after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Expected an identifier, number, function, or parentheses sub-expression, got '%.*s'";
             break;
+        case PARSE_ERROR_MISSING_PAREN:
+            diag_report(sink, DIAG_ERROR, DIAG_SYNTAX, diagnostic->error, location, "Expected '%s' before '%.*s'",
+                        diagnostic->expected == TOKEN_LEFTPARENTHESES ? "(" : ")", TOKEN_TEXT(source, token));
+            return;
         case PARSE_ERROR_MISSING_CONDITION:
-            printf("Missing condition after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Missing condition after '%.*s'";
             break;
         case PARSE_ERROR_MISSING_BRACE:
-            printf("Missing brace after '%s' at position '%d'\n", token.lexeme, position);
+            format = "Missing brace after '%.*s'";
             break;
         case PARSE_ERROR_FUNC_CALL:
-            printf("Function call '%s' at position '%d'\n", token.lexeme, position);
+            format = "Function call '%.*s'";
+            break;
+        case PARSE_ERROR_BREAK_OUTSIDE_LOOP:
+            format = "'%.*s' outside of a loop";
             break;
         default:
-            printf("Unknown error\n");
+            diag_report(sink, DIAG_ERROR, DIAG_SYNTAX, diagnostic->error, location, "Unknown error");
+            return;
     }
+    diag_report(sink, DIAG_ERROR, DIAG_SYNTAX, diagnostic->error, location, format, TOKEN_TEXT(source, token));
 }
 
-// Get next token
-static void advance(void) {
-    current_token = get_next_token(source, &position);
-}
-
-/* ---PARSER FLOW AND CONTROL FUNCTIONS--- */
-// Create a new AST node
-static ASTNode *create_node(ASTNodeType type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (node) {
-        node->type = type;
-        node->token = current_token;
-        node->left = NULL;
-        node->right = NULL;
+void report_parse_errors(const ParserState *parser, DiagSink *sink) {
+    for (size_t i = 0; i < parser->diagnostic_count; i++) {
+        report_parse_error(parser, &parser->diagnostics[i], sink);
     }
-    return node;
 }
 
-// Match current token with expected type
-static int match(TokenType type) {
-    return current_token.type == type;
-}
-
-// Expect a token type or error
-// Globally advances on success
-static void expect(TokenType type) {
-    if (match(type)) {
-        advance();
-    } else {
-        printf("Invalid token, got '%s' Expected type: '%d'", current_token.lexeme, type);
-
-        exit(1); // Or implement error recovery
-    }
+// Only the first error of a statement is kept, the rest usually follow from it
+__attribute__((cold, noinline))
+void parser_record_error(ParserState *parser, ParseError error, TokenType expected) {
+    if (parser->panic) return;
+    parser->panic = 1;
+    if (parser->diagnostic_count == parser->diagnostic_capacity) {
+        size_t capacity = parser->diagnostic_capacity ? parser->diagnostic_capacity * 2 : 16;
+        ParseDiagnostic *diagnostics = realloc(parser->diagnostics, capacity * sizeof(ParseDiagnostic));
+        if (!diagnostics) return;
+        parser->diagnostics = diagnostics;
+        parser->diagnostic_capacity = capacity;
+    }
+    ParseDiagnostic *diagnostic = &parser->diagnostics[parser->diagnostic_count++];
+    diagnostic->error = (uint8_t)error;
+    diagnostic->expected = (uint8_t)expected;
+    diagnostic->token = (uint32_t)parser->index;
 }
 
 // Forward declarations for functions
-static ASTNode *parse_statement(void);
-static ASTNode *parse_declaration(void);
-static ASTNode *parse_expression(void);
-static ASTNode *parse_assignment_or_function(void);
-static ASTNode *parse_block_statement(void);
+static NodeId parse_statement(ParserState *parser);
+static inline void parse_sequence_statement(ParserState *parser);
+static NodeId parse_expression(ParserState *parser);
+static NodeId parse_assignment_or_function(ParserState *parser);
+static NodeId parse_block_statement(ParserState *parser);
 
 /* ---PARSING FUNCTIONS FOR KEYWORDS AND PRE-MADE FUNCTIONS--- */
 // Parses if() statements
-static ASTNode* parse_if_statement(void) {
-    ASTNode *node = create_node(AST_IF);
-    advance(); // consume if keyword
-    expect(TOKEN_LEFTPARENTHESES); // check for correct parentheses (
-    node->left = parse_expression(); // conditions in if stored in left child (handled by parse_expression)
-    expect(TOKEN_RIGHTPARENTHESES);  // check for correct parentheses )
-    node->right = parse_statement(); // if body (handled by parse_statement)
+static NodeId parse_if_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_IF);
+    advance(parser); // consume if keyword
+    expect(parser, TOKEN_LEFTPARENTHESES); // check for correct parentheses (
+    set_left(parser, node, parse_expression(parser)); // conditions in if stored in left child (handled by parse_expression)
+    expect(parser, TOKEN_RIGHTPARENTHESES);  // check for correct parentheses )
+    set_right(parser, node, parse_statement(parser)); // if body (handled by parse_statement)
     return node;
 }
 
 // Parses else statements
-static ASTNode* parse_else_statement(void) {
-    ASTNode *node = create_node(AST_ELSE);
-    advance(); // consume else keyword
-    node->right = parse_statement(); // else body (handled by parse_statement)
+static NodeId parse_else_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_ELSE);
+    advance(parser); // consume else keyword
+    set_right(parser, node, parse_statement(parser)); // else body (handled by parse_statement)
     return node;
 }
 
 // Parses while loop statements
-static ASTNode* parse_while_statement(void) {
-    ASTNode *node = create_node(AST_WHILE);
-    advance(); // consume while keyword
-    expect(TOKEN_LEFTPARENTHESES); // check for correct parentheses (
-    node->left = parse_expression(); // conditions for looping within while (handled by parse_expression)
-    expect(TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
-    node->right = parse_statement(); // loop body (handled by parse_statement)
+static NodeId parse_while_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_WHILE);
+    advance(parser); // consume while keyword
+    expect(parser, TOKEN_LEFTPARENTHESES); // check for correct parentheses (
+    set_left(parser, node, parse_expression(parser)); // conditions for looping within while (handled by parse_expression)
+    expect(parser, TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
+    parser->loops++;
+    set_right(parser, node, parse_statement(parser)); // loop body (handled by parse_statement)
+    parser->loops--;
     return node;
 }
 
@@ -124,20 +122,22 @@ static ASTNode* parse_while_statement(void) {
  *      body code
  *  } until();
  */
-static ASTNode* parse_until_statement(void) {
-    ASTNode *node = create_node(AST_REPEAT);
-    advance(); // consume repeat keyword
-    node->right = parse_statement(); // repeated body (handled by parse_statement)
+static NodeId parse_until_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_REPEAT);
+    advance(parser); // consume repeat keyword
+    parser->loops++;
+    set_right(parser, node, parse_statement(parser)); // repeated body (handled by parse_statement)
+    parser->loops--;
     // following block statement, need until()
-    if (!match(TOKEN_UNTIL)) { // case without until
-        parse_error(PARSE_ERROR_UNEXPECTED_TOKEN, current_token);
-        exit(1);
-    }
-    advance(); // consume until keyword
-    expect(TOKEN_LEFTPARENTHESES); // check for correct parentheses (
-    node->left = parse_expression(); // conditions for looping (handled by parse_expression)
-    expect(TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
-    expect(TOKEN_SEMICOLON); // check semicolon after conditions
+    if (!match(parser, TOKEN_UNTIL)) { // case without until
+        parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN);
+        return node;
+    }
+    advance(parser); // consume until keyword
+    expect(parser, TOKEN_LEFTPARENTHESES); // check for correct parentheses (
+    set_left(parser, node, parse_expression(parser)); // conditions for looping (handled by parse_expression)
+    expect(parser, TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
+    expect(parser, TOKEN_SEMICOLON); // check semicolon after conditions
     return node;
 }
 
@@ -145,17 +145,38 @@ static ASTNode* parse_until_statement(void) {
 /* STATEMENTS HAVE THE FORM
  *  print(expression);
  */
-static ASTNode* parse_print_statement(void) {
-    ASTNode *node = create_node(AST_PRINT);
-    advance(); // consume print keyword
-    expect(TOKEN_LEFTPARENTHESES); // check for correct parentheses (
-    node->left = parse_expression();
-    expect(TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        exit(1);
-    }
-    advance();
+static NodeId parse_print_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_PRINT);
+    advance(parser); // consume print keyword
+    expect(parser, TOKEN_LEFTPARENTHESES); // check for correct parentheses (
+    set_left(parser, node, parse_expression(parser));
+    expect(parser, TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
+    }
+    advance(parser);
+    return node;
+}
+
+// Parses break statements, only allowed in the body of a loop
+/* STATEMENTS HAVE THE FORM
+ *  break;
+ */
+static NodeId parse_break_statement(ParserState *parser) {
+    if (parser->loops == 0) { // Fails on its first token, so nothing is kept, but the keyword is used up
+        parse_error(parser, PARSE_ERROR_BREAK_OUTSIDE_LOOP);
+        NodeId error = create_node(parser, AST_ERROR);
+        advance(parser);
+        return error;
+    }
+    NodeId node = create_node(parser, AST_BREAK);
+    advance(parser); // consume break keyword
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
+    }
+    advance(parser);
     return node;
 }
 
@@ -165,507 +186,457 @@ static ASTNode* parse_print_statement(void) {
  *  or
  *  x = $(expression);
  */
-static ASTNode *parse_factorial(void){
-    ASTNode *node = create_node(AST_FACTORIAL);
-    advance(); // consume factorial symbol $
-    expect(TOKEN_LEFTPARENTHESES); // check for correct parentheses (
-    node->left = parse_expression(); // parse expression should handle the arguments for the function
-    expect(TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
+static NodeId parse_factorial(ParserState *parser){
+    NodeId node = create_node(parser, AST_FACTORIAL);
+    advance(parser); // consume factorial symbol $
+    expect(parser, TOKEN_LEFTPARENTHESES); // check for correct parentheses (
+    set_left(parser, node, parse_expression(parser)); // parse expression should handle the arguments for the function
+    expect(parser, TOKEN_RIGHTPARENTHESES); // check for correct parentheses )
     return node;
 }
 
 // Parses block statements (the { ... } inside of a function, if statement, loop, etc)
-static ASTNode* parse_block_statement(void) {
-    ASTNode *node = create_node(AST_BLOCK);
-    ASTNode *current = node; // track the current node as to build the full block statement tree
-    advance(); // consume { symbol
+static NodeId parse_block_statement(ParserState *parser) {
+    NodeId node = create_node(parser, AST_BLOCK);
+    size_t first = parser->statement_count; // statements of enclosing blocks stay queued below this
+    advance(parser); // consume { symbol
+    cons_enter_block(parser);
     // will continue to build the tree of the block
-    while (!match(TOKEN_RIGHTBRACE) && !match(TOKEN_EOF)) {
-        ASTNode *next_statement = parse_statement();
-        //builds to the left on with first statement
-        current->left = next_statement;
-        if(!match(TOKEN_RIGHTBRACE)) {
-            current->right = create_node(AST_PROGRAM);
-            current = current->right;
-        }
+    while (!match(parser, TOKEN_RIGHTBRACE) && !match(parser, TOKEN_EOF)) {
+        parse_sequence_statement(parser);
     }
+    end_sequence(parser, node, first);
+    cons_leave_block(parser);
     // checks the condition that ended the loop (should be } if correct)
-    if (!match(TOKEN_RIGHTBRACE)) {
-        parse_error(PARSE_ERROR_MISSING_BRACE, current_token);
-        exit(1);
+    if (!match(parser, TOKEN_RIGHTBRACE)) {
+        parse_error(parser, PARSE_ERROR_MISSING_BRACE);
+        return node;
     }
-    advance(); // consume } symbol
+    advance(parser); // consume } symbol
     return node;
 }
 
 /* ---PARSING FUNCTIONS FOR BASIC DECLARATIONS AND ASSIGNMENTS--- */
 // Parse variable declaration: e.g. int x;
-static ASTNode *parse_declaration(void) {
-    ASTNode *node;
-    if (match(TOKEN_INT)){
-        node = create_node(AST_INT);
+NodeId parse_declaration(ParserState *parser) {
+    NodeId node = NODE_NONE;
+    cons_declare(parser);
+    if (match(parser, TOKEN_INT)){
+        node = create_node(parser, AST_INT);
     }
-    if(match(TOKEN_CHAR) || match(TOKEN_STRING)) {
-        node = create_node(AST_STRINGCHAR);
+    if(match(parser, TOKEN_CHAR) || match(parser, TOKEN_STRING)) {
+        node = create_node(parser, AST_STRINGCHAR);
     }
-    advance(); // consume data-type
+    advance(parser); // consume data-type
 
-    if (!match(TOKEN_IDENTIFIER)) {
-        parse_error(PARSE_ERROR_MISSING_IDENTIFIER, current_token);
-        exit(1);
+    if (!match(parser, TOKEN_IDENTIFIER)) {
+        parse_error(parser, PARSE_ERROR_MISSING_IDENTIFIER);
+        return node;
     }
 
-    node->token = current_token;
-    advance();
+    parser->ast.token[node] = (uint32_t)parser->index;
+    advance(parser);
 
     // Correct case
-    if(match(TOKEN_SEMICOLON)) {
-        advance();
+    if(match(parser, TOKEN_SEMICOLON)) {
+        advance(parser);
         return node;
     }
     // Failed case
-    parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-    exit(1);
+    parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+    return node;
 }
 
 // Parse assignment or function call: e.g. x = 5; or x = 'yippee'; or x = $(5);
-static ASTNode *parse_assignment_or_function(void) {
-    ASTNode *node = create_node(AST_ASSIGN);
-    node->left = create_node(AST_IDENTIFIER);
-    node->left->token = current_token;
-    advance();
+static NodeId parse_assignment_or_function(ParserState *parser) {
+    NodeId node = create_node(parser, AST_ASSIGN);
+    set_left(parser, node, create_node(parser, AST_IDENTIFIER));
+    advance(parser);
 
     // Check equals
-    if (!match(TOKEN_EQUALS)) {
-        parse_error(PARSE_ERROR_MISSING_EQUALS, current_token);
-        exit(1);
+    if (!match(parser, TOKEN_EQUALS)) {
+        parse_error(parser, PARSE_ERROR_MISSING_EQUALS);
+        return node;
     }
-    advance();
+    advance(parser);
 
     // For the case where the assignment is for strings, chars, or null values
-    if(match(TOKEN_STRING) || match(TOKEN_CHAR)) {
-        node->right = create_node(AST_STRINGCHAR);
-        node->right->token = current_token;
-        advance();
+    if(match(parser, TOKEN_STRING) || match(parser, TOKEN_CHAR)) {
+        set_right(parser, node, create_node(parser, AST_STRINGCHAR));
+        advance(parser);
     }
-    else if(match(TOKEN_NULL)) { // Null assignment
-        node->right = create_node(AST_NULL);
-        node->right->token = current_token;
-        advance();
+    else if(match(parser, TOKEN_NULL)) { // Null assignment
+        set_right(parser, node, create_node(parser, AST_NULL));
+        advance(parser);
     }
-    else if(match(TOKEN_FACTORIAL)) { // factorial operation
-        node->right = parse_factorial();
+    else if(match(parser, TOKEN_FACTORIAL)) { // factorial operation
+        set_right(parser, node, parse_factorial(parser));
     }
     else { // All other assignment types
-        node->right = parse_expression();
+        set_right(parser, node, parse_expression(parser));
     }
 
 
     // Parse_expression(), string assignment, and function calls all advance, check that statement ended with ;
-    if (!match(TOKEN_SEMICOLON)) {
-        parse_error(PARSE_ERROR_MISSING_SEMICOLON, current_token);
-        exit(1);
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+        return node;
     }
 
-    advance();
+    advance(parser);
     return node;
 }
 
 // Parse statement
-static ASTNode *parse_statement(void) {
-    if (match(TOKEN_INT) || match(TOKEN_CHAR) || match(TOKEN_STRING)) return parse_declaration();
-    if (match(TOKEN_IDENTIFIER)) return parse_assignment_or_function();
-    if (match(TOKEN_IF)) return parse_if_statement();
-    if (match(TOKEN_ELSE)) return parse_else_statement();
-    if (match(TOKEN_WHILE)) return parse_while_statement();
-    if (match(TOKEN_REPEAT)) return parse_until_statement();
-    if (match(TOKEN_PRINT)) return parse_print_statement();
-    if (match(TOKEN_LEFTBRACE)) return parse_block_statement();
-
-    printf("Syntax Error: Unexpected token %s at position %d line %d\n", current_token.lexeme, position, current_token.line);
-    exit(1);
+static NodeId parse_statement(ParserState *parser) {
+    if (match(parser, TOKEN_INT) || match(parser, TOKEN_CHAR) || match(parser, TOKEN_STRING)) return parse_declaration(parser);
+    if (match(parser, TOKEN_IDENTIFIER)) return parse_assignment_or_function(parser);
+    if (match(parser, TOKEN_IF)) return parse_if_statement(parser);
+    if (match(parser, TOKEN_ELSE)) return parse_else_statement(parser);
+    if (match(parser, TOKEN_WHILE)) return parse_while_statement(parser);
+    if (match(parser, TOKEN_REPEAT)) return parse_until_statement(parser);
+    if (match(parser, TOKEN_PRINT)) return parse_print_statement(parser);
+    if (match(parser, TOKEN_BREAK)) return parse_break_statement(parser);
+    if (match(parser, TOKEN_LEFTBRACE)) return parse_block_statement(parser);
+
+    parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN);
+    return create_node(parser, AST_ERROR);
 }
 
 //for things like identifiers, numbers, functions, and nested expressions
-static ASTNode *parse_non_ops(void) {
-    ASTNode *node;
-    if (match(TOKEN_NUMBER)) {
-        node = create_node(AST_NUMBER);
-        advance();
+static NodeId parse_non_ops(ParserState *parser) {
+    NodeId node;
+    if (match(parser, TOKEN_NUMBER)) {
+        node = cons_node(parser, create_node(parser, AST_NUMBER));
+        advance(parser);
         return node;
     }
-    if (match(TOKEN_IDENTIFIER)) {
-        node = create_node(AST_IDENTIFIER);
-        advance();
+    if (match(parser, TOKEN_IDENTIFIER)) {
+        node = cons_node(parser, create_node(parser, AST_IDENTIFIER));
+        advance(parser);
         return node;
     }
-    if (match(TOKEN_FACTORIAL)) { // factorial case
-        node = parse_factorial();
-        advance();
+    if (match(parser, TOKEN_FACTORIAL)) { // factorial case
+        node = parse_factorial(parser);
+        advance(parser);
         return node;
     }
-    if (match(TOKEN_STRING_LITERAL) || match(TOKEN_CHAR_LITERAL)) {
-        node = create_node(AST_STRINGCHAR);
-        advance();
+    if (match(parser, TOKEN_STRING_LITERAL) || match(parser, TOKEN_CHAR_LITERAL)) {
+        node = cons_node(parser, create_node(parser, AST_STRINGCHAR));
+        advance(parser);
         return node;
     }
-    if (match(TOKEN_LEFTPARENTHESES)) {
-        advance();
+    if (match(parser, TOKEN_LEFTPARENTHESES)) {
+        advance(parser);
         //call recursively on expression in parentheses
-        node = parse_expression();
-        expect(TOKEN_RIGHTPARENTHESES);//make sure it closes
+        node = parse_expression(parser);
+        expect(parser, TOKEN_RIGHTPARENTHESES);//make sure it closes
         return node;
     }
-    printf("Expected an identifier, number, function, or parentheses sub-expression\n");
-    printf("Token: %s LINE: %d\n", current_token.lexeme, current_token.line);
-    exit(1);
-}
-
-static ASTNode *parse_not(void) {
-    ASTNode *node = parse_non_ops();
-    while (strcmp(current_token.lexeme, "!")==0) {
-        Token operator = current_token;
-        advance();
-        ASTNode *new = create_node(AST_UNARYOP);
-        new->token = operator;
-        new->left = node;
-        new->right;
-        node = new;
-    }
-    return node;
+    parse_error(parser, PARSE_ERROR_INVALID_EXPRESSION);
+    return create_node(parser, AST_ERROR);
 }
 
-static ASTNode *parse_pow(void) {
-    ASTNode *node = parse_not();
-    while (strcmp(current_token.lexeme, "^^")==0){
-        Token operator = current_token;
-        advance();
-        ASTNode *left = parse_not();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = left;
-        new->right = node;
-        node = new;
+const OperatorInfo parser_binary_operators[TOKEN_TYPE_COUNT] = {
+    [TOKEN_OR]            = {1, 0},
+    [TOKEN_AND]           = {2, 0},
+    [TOKEN_EQUAL_EQUAL]   = {3, 0}, [TOKEN_NOT_EQUAL]     = {3, 0},
+    [TOKEN_GREATER]       = {4, 0}, [TOKEN_LESS]          = {4, 0},
+    [TOKEN_GREATER_EQUAL] = {4, 0}, [TOKEN_LESS_EQUAL]    = {4, 0},
+    [TOKEN_PLUS]          = {5, 0}, [TOKEN_MINUS]         = {5, 0},
+    [TOKEN_STAR]          = {6, 0}, [TOKEN_SLASH]         = {6, 0},
+    [TOKEN_POWER]         = {7, 1},
+};
+
+// Operand followed by any number of postfix ! (binds tighter than every binary operator)
+static NodeId parse_not(ParserState *parser) {
+    NodeId node = parse_non_ops(parser);
+    while (match(parser, TOKEN_NOT)) {
+        size_t operator = parser->index;
+        advance(parser);
+        NodeId new = create_node_at(parser, AST_UNARYOP, operator);
+        set_left(parser, new, node);
+        node = cons_node(parser, new);
     }
     return node;
 }
 
-static ASTNode *parse_mult_div_mod(void) {
-    ASTNode *node = parse_pow();
-    while (strcmp(current_token.lexeme, "/")==0 || strcmp(current_token.lexeme, "*")==0){
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_pow();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
+// Precedence climbing: keeps joining operators that bind at least as tight as min_precedence
+// A left associative operator parses its right operand one level tighter so the loop picks up the next one
+static NodeId parse_binary(ParserState *parser, int min_precedence) {
+    NodeId node = parse_not(parser);
+    while (1) {
+        OperatorInfo info = parser_binary_operators[peek(parser, 0)];
+        if (info.precedence == 0 || info.precedence < min_precedence) break;
+        size_t operator = parser->index;
+        advance(parser);
+        NodeId right = parse_binary(parser, info.right_associative ? info.precedence : info.precedence + 1);
+        NodeId new = create_node_at(parser, AST_BINOP, operator);
+        set_left(parser, new, node);
+        set_right(parser, new, right);
+        node = cons_node(parser, new);
     }
     return node;
 }
 
-static ASTNode *parse_add_sub(void) {
-    ASTNode *node = parse_mult_div_mod();
-    while (strcmp(current_token.lexeme, "+")==0 || strcmp(current_token.lexeme, "-")==0) {
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_mult_div_mod();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
-        }
-    return node;
-}
-
-static ASTNode *parse_grt_geq_leq_les(void) {
-    ASTNode *node = parse_add_sub();
-    while (strcmp(current_token.lexeme, ">")==0 || strcmp(current_token.lexeme, "<")==0
-        || strcmp(current_token.lexeme, ">=")==0 || strcmp(current_token.lexeme, "<=")==0){
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_add_sub();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
-        }
-    return node;
+static NodeId parse_expression(ParserState *parser) {
+    return parse_binary(parser, 1);
 }
 
-static ASTNode *parse_logical_eq_not_eq(void) {
-    ASTNode *node = parse_grt_geq_leq_les();
-    while (strcmp(current_token.lexeme, "==")==0 || strcmp(current_token.lexeme, "!=")==0) {
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_grt_geq_leq_les();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
-        }
-    return node;
+/* ---ERROR RECOVERY--- */
+static int is_statement_keyword(TokenType type) {
+    switch (type) {
+        case TOKEN_INT: case TOKEN_CHAR: case TOKEN_STRING:
+        case TOKEN_IF: case TOKEN_ELSE: case TOKEN_WHILE: case TOKEN_REPEAT:
+        case TOKEN_PRINT: case TOKEN_BREAK:
+            return 1;
+        default:
+            return 0;
+    }
 }
 
-static ASTNode *parse_logical_and(void) {
-    ASTNode *node = parse_logical_eq_not_eq();
-    while (strcmp(current_token.lexeme, "&&")==0){
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_logical_eq_not_eq();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
-        }
-    return node;
+// Panic mode: skip to just after a `;` or `}`, or up to a `}` or statement keyword, whichever comes first
+// A statement that failed on its first token gives that token up so the parser always moves on
+static void synchronize(ParserState *parser, size_t start) {
+    if (parser->index == start) advance(parser);
+    while (!match(parser, TOKEN_EOF)) {
+        TokenType previous = (TokenType)parser->tokens->types[parser->index - 1];
+        if (previous == TOKEN_SEMICOLON || previous == TOKEN_RIGHTBRACE) break;
+        if (match(parser, TOKEN_RIGHTBRACE) || is_statement_keyword(peek(parser, 0))) break;
+        advance(parser);
+    }
+    parser->panic = 0;
 }
 
-static ASTNode *parse_logical_or(void) {
-    ASTNode *node = parse_logical_and();
-    while (strcmp(current_token.lexeme, "||")==0){
-        Token operator = current_token;
-        advance();
-        ASTNode *right = parse_logical_and();
-        ASTNode *new = create_node(AST_BINOP);
-        new->token = operator;
-        new->left = node;
-        new->right = right;
-        node = new;
+__attribute__((cold, noinline))
+NodeId parser_recover_statement(ParserState *parser, NodeId statement, size_t start) {
+    if (ast_kind(&parser->ast, statement) != AST_ERROR) {
+        NodeId error = create_node_at(parser, AST_ERROR, start);
+        set_left(parser, error, statement);
+        statement = error;
     }
-    return node;
+    synchronize(parser, start);
+    return statement;
 }
 
-static ASTNode *parse_expression(void) {
-    ASTNode *node = parse_logical_or();
-    return node;
+// Parse one statement of a program or block into the open sequence
+// Panic mode left by an enclosing statement (a block after a broken condition) is lifted while the
+// statement is parsed, so errors inside the block are reported too, and restored for the enclosing statement.
+static inline void parse_sequence_statement(ParserState *parser) {
+    int inherited = parser->panic;
+    size_t start = parser->index;
+    parser->panic = 0;
+    NodeId statement = parse_statement(parser);
+    if (parser->panic) statement = parser_recover_statement(parser, statement, start);
+    push_statement(parser, statement);
+    parser->panic = inherited;
 }
 
 /* ---PARSER INITIALIZATION AND OUTPUT FUNCTIONS--- */
 
-// Parse program (multiple statements)
-static ASTNode *parse_program(void) {
-    //right recursive grammar
-    ASTNode *program = create_node(AST_PROGRAM);
-    ASTNode *current = program;
-
-    while (!match(TOKEN_EOF)) {
-        current->left = parse_statement();
-        // parse_statement() contains advance() calls, hence re-check
-        if (!match(TOKEN_EOF)) {
-            current->right = create_node(AST_PROGRAM);
-            current = current->right;
-        }
+void parse_top_level(ParserState *parser, size_t end) {
+    while (parser->index < end && !match(parser, TOKEN_EOF)) {
+        parse_sequence_statement(parser);
     }
+}
+
+// Parse program (multiple statements)
+static NodeId parse_program(ParserState *parser) {
+    // the program is one sequence holding every top level statement
+    NodeId program = create_node(parser, AST_PROGRAM);
+    size_t first = parser->statement_count;
+
+    parse_top_level(parser, SIZE_MAX);
+    end_sequence(parser, program, first);
     return program;
 }
 
 // Initialize parser
-void parser_init(const char *input) {
-    source = input;
-    position = 0;
-    advance(); // Get first token
+void parser_init(ParserState *parser, TokenBuffer *tokens) {
+    parser->tokens = tokens;
+    parser->index = 0; // First token
+    ast_init(&parser->ast, tokens);
+    parser->statements = NULL;
+    parser->statement_count = 0;
+    parser->statement_capacity = 0;
+    parser->diagnostics = NULL;
+    parser->diagnostic_count = 0;
+    parser->diagnostic_capacity = 0;
+    parser->panic = 0;
+    parser->loops = 0;
+    parser->frames = NULL;
+    parser->frame_capacity = 0;
+    parser->workers = NULL;
+    parser->stale = 0;
+    parser->cons = NULL;
 }
 
-// Main parse function
-ASTNode *parse(void) {
-    return parse_program();
+// Parse the same buffer again, trees from earlier parses are invalidated and their memory reused
+void parser_reset(ParserState *parser) {
+    parser->index = 0;
+    ast_reset(&parser->ast);
+    parser->statement_count = 0;
+    parser->diagnostic_count = 0;
+    parser->panic = 0;
+    parser->loops = 0;
+    parser->stale = 0;
+    if (parser->cons) parser_cons_reset(parser);
 }
 
-// Print AST (for debugging)
-void print_ast(ASTNode *node, int level) {
-    if (!node) return;
-
-    // Indent based on level
-    for (int i = 0; i < level; i++) printf("  ");
-
-    // Print node info
-    switch (node->type) {
-        case AST_PROGRAM:
-            printf("Program\n");
-            break;
-        case AST_ASSIGN:
-            printf("Assign Int\n");
-            break;
-        case AST_PRINT:
-            printf("Print\n");
-            break;
-        case AST_NUMBER:
-            printf("Number: %s\n", node->token.lexeme);
-            break;
-        case AST_IDENTIFIER:
-            printf("Identifier: %s\n", node->token.lexeme);
-            break;
-        case AST_INT:
-            printf("Int: %s\n", node->token.lexeme);
-            break;
-        case AST_STRINGCHAR:
-            printf("String/Char: %s\n", node->token.lexeme);
-            break;
-        //control flow cases
-        case AST_IF:
-            printf("If statement\n");
-            break;
-        case AST_ELSE:
-            printf("Else statement\n");
-            break;
-        case AST_WHILE:
-            printf("While statement\n");
-            break;
-        case AST_REPEAT:
-            printf("Repeat-Until statement\n");
-            break;
-        case AST_BREAK:
-            printf("Break statement\n");
-            break;
-        case AST_BLOCK:
-            printf("Block\n");
-            break;
-        //expression cases
-        case AST_BINOP:
-            printf("Binary operator: %s\n", node->token.lexeme);
-            break;
-        case AST_UNARYOP:
-            printf("Unary operator: %s\n", node->token.lexeme);
-            break;
-        case AST_COMPARISON:
-            printf("Comparison operator: %s\n", node->token.lexeme);
-            break;
-        case AST_LOGIC_OP:
-            printf("Logical operator: %s\n", node->token.lexeme);
-            break;
-        case AST_CAST:
-            printf("Cast: %s\n", node->token.lexeme);
-            break;
-        case AST_NULL:
-            printf("Null\n");
-            break;
-        case AST_FACTORIAL:
-            printf("Factorial %s\n", node->token.lexeme);
-            break;
-        case AST_EXPRESSION:
-            printf("Expression\n");
-            break;
-        default:
-            printf("Unknown node type\n");
-    }
+// Free every tree built by this parser at once
+void parser_free(ParserState *parser) {
+    ast_free(&parser->ast);
+    free(parser->statements);
+    free(parser->diagnostics);
+    free(parser->frames);
+    parse_workers_free(parser);
+    parser_set_hash_consing(parser, 0);
+    parser_init(parser, parser->tokens);
+}
 
-    // Print children
-    print_ast(node->left, level + 1);
-    print_ast(node->right, level + 1);
+// Main parse function
+NodeId parse(ParserState *parser) {
+    return parse_program(parser);
 }
 
-// Free AST memory
-void free_ast(ASTNode *node) {
-    if (!node) return;
-    free_ast(node->left);
-    free_ast(node->right);
-    free(node);
+// Print AST (for debugging)
+// Walks with an explicit stack, so deeply nested blocks and long operator chains print without recursing
+void print_ast(const Ast *ast, NodeId root, int level) {
+    const char *source = ast->tokens->source->data;
+    AstWalk walk;
+    NodeId node;
+    ast_walk_begin(&walk, ast, root, level);
+    while (ast_walk_next(&walk, &node, &level)) {
+        // Indent based on level
+        for (int i = 0; i < level; i++) printf("  ");
+
+        // Print node info
+        switch (ast_kind(ast, node)) {
+            case AST_PROGRAM:
+                printf("Program\n");
+                break;
+            case AST_ASSIGN:
+                printf("Assign Int\n");
+                break;
+            case AST_PRINT:
+                printf("Print\n");
+                break;
+            case AST_NUMBER:
+                printf("Number: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_IDENTIFIER:
+                printf("Identifier: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_INT:
+                printf("Int: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_STRINGCHAR:
+                printf("String/Char: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            //control flow cases
+            case AST_IF:
+                printf("If statement\n");
+                break;
+            case AST_ELSE:
+                printf("Else statement\n");
+                break;
+            case AST_WHILE:
+                printf("While statement\n");
+                break;
+            case AST_REPEAT:
+                printf("Repeat-Until statement\n");
+                break;
+            case AST_BREAK:
+                printf("Break statement\n");
+                break;
+            case AST_BLOCK:
+                printf("Block\n");
+                break;
+            //expression cases
+            case AST_BINOP:
+                printf("Binary operator: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_UNARYOP:
+                printf("Unary operator: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_COMPARISON:
+                printf("Comparison operator: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_LOGIC_OP:
+                printf("Logical operator: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_CAST:
+                printf("Cast: ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_NULL:
+                printf("Null\n");
+                break;
+            case AST_FACTORIAL:
+                printf("Factorial ");
+                print_token_text(source, ast_token(ast, node));
+                printf("\n");
+                break;
+            case AST_EXPRESSION:
+                printf("Expression\n");
+                break;
+            case AST_ERROR:
+                printf("Error\n");
+                break;
+            default:
+                printf("Unknown node type\n");
+        }
+    }
+    ast_walk_end(&walk);
 }
 
 /* KEEPING OLD MAIN FOR REFERENCING
 // Main function for testing
 int main() {
-    // get file
-    FILE *file = fopen("../phase2-w25/test/input_valid.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
-
-    // get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    char *buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
-
-    // fill buffer with full file of chars in order
-    size_t bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    size_t b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
+    const char *paths[] = {"../phase2-w25/test/input_valid.txt", "../phase2-w25/test/input_invalid.txt"};
+    for (int i = 0; i < 2; i++) {
+        // get file, the lexer skips the \r of CRLF line endings as whitespace
+        Source source;
+        if (!source_load(&source, paths[i])) {
+            return 1;
         }
-    }
-    buffer[b] = '\0';
-
-    // start at beginning of buffer
-    position = 0;
-
-    // Start Parsing
-    printf(buffer);
-    parser_init(buffer);
-    ASTNode *ast = parse();
-
-    // Print Parsed Tree
-    print_ast(ast, 0);
-
-    // free memory and close file
-    free(buffer);
-    fclose(file);
-
-    // Repeat for Incorrect file
-    position = 0;
-
-    // get file
-    file = fopen("../phase2-w25/test/input_invalid.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
-
-    // get file size
-    fseek(file, 0, SEEK_END);
-    file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
-
-    // fill buffer with full file of chars in order
-    bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
+        TokenBuffer tokens;
+        if (!lex_all(&tokens, &source)) {
+            source_free(&source);
+            return 1;
         }
-    }
-    buffer[b] = '\0';
-
-    // Repeat for Incorrect file
-    position = 0;
 
-    // Start Parsing
-    printf(buffer);
-    parser_init(buffer);
-    ast = parse();
+        // Start Parsing
+        printf("%s\n", source.data);
+        ParserState parser;
+        parser_init(&parser, &tokens);
+        NodeId ast = parse(&parser);
 
-    // Print Parsed Tree
-    print_ast(ast, 0);
+        // Print Parsed Tree
+        print_ast(&parser.ast, ast, 0);
 
-    // free memory "he ain't deserve to be locked up"
-    free(ast);
-    free(buffer);
-    fclose(file);
+        // free memory "he ain't deserve to be locked up"
+        parser_free(&parser);
+        token_buffer_free(&tokens);
+        source_free(&source);
+    }
     return 0;
 }
 */
\ No newline at end of file
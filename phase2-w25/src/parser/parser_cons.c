@@ -0,0 +1,137 @@
+/* parser_cons.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/parser.h"
+#include "../../include/parser_internal.h"
+
+/* Hash-consing of expression nodes.
+ * Numbers, literals, names and the operators over them are looked up by content as soon as they are built:
+ * kind, token type, atom and children. Children are looked up before their parent, so equal subtrees come out
+ * as the same node and a parent only has to compare child ids. A node that is already known is dropped again,
+ * it is always the last one added, and the parser goes on with the one from the table.
+ * A name means a different variable once a declaration may shadow it, so identifiers are also keyed by a
+ * scope id. A block gets a new id and gives the one it started in back when it closes, and every declaration
+ * gets a new id, so two uses share a node only when they see the same declarations. */
+
+typedef struct {
+    NodeId node;                // NODE_NONE for an empty slot
+    uint32_t scope;             // Scope id of an identifier, 0 for other nodes
+} ConsEntry;
+
+typedef struct ConsTable {
+    ConsEntry* slots;
+    size_t slot_count;          // Power of two
+    size_t count;
+    uint32_t scope;             // Id of the declarations visible at the current token
+    uint32_t next_scope;
+    uint32_t* scopes;           // Ids of the open blocks' enclosing scopes, innermost last
+    size_t depth;
+    size_t capacity;
+} ConsTable;
+
+static uint64_t cons_hash(const Ast* ast, NodeId node, uint32_t scope) {
+    uint64_t hash = (uint64_t)ast->kind[node] << 40 ^ (uint64_t)ast->tokens->types[ast->token[node]] << 32
+                    ^ ast->tokens->atoms[ast->token[node]];
+    hash = (hash ^ scope) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ ast->left[node]) * 0xFF51AFD7ED558CCDull;
+    hash = (hash ^ ast->right[node]) * 0xC4CEB9FE1A85EC53ull;
+    return hash ^ (hash >> 31);
+}
+
+static int cons_equal(const Ast* ast, NodeId a, NodeId b) {
+    return ast->kind[a] == ast->kind[b] && ast->left[a] == ast->left[b] && ast->right[a] == ast->right[b]
+           && ast->tokens->types[ast->token[a]] == ast->tokens->types[ast->token[b]]
+           && ast->tokens->atoms[ast->token[a]] == ast->tokens->atoms[ast->token[b]];
+}
+
+static void cons_grow(ConsTable* table, const Ast* ast) {
+    size_t slot_count = table->slot_count ? table->slot_count * 2 : 1024;
+    ConsEntry* slots = calloc(slot_count, sizeof(ConsEntry));
+    if (!slots) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < table->slot_count; i++) {
+        ConsEntry entry = table->slots[i];
+        if (entry.node == NODE_NONE) continue;
+        size_t slot = cons_hash(ast, entry.node, entry.scope) & (slot_count - 1);
+        while (slots[slot].node != NODE_NONE) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = entry;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+}
+
+NodeId parser_cons_node(ParserState* parser, NodeId node) {
+    ConsTable* table = parser->cons;
+    Ast* ast = &parser->ast;
+    if (table->count * 2 >= table->slot_count) cons_grow(table, ast);
+    uint32_t scope = ast->kind[node] == AST_IDENTIFIER ? table->scope : 0;
+    size_t slot = cons_hash(ast, node, scope) & (table->slot_count - 1);
+    while (table->slots[slot].node != NODE_NONE) {
+        ConsEntry entry = table->slots[slot];
+        if (entry.scope == scope && cons_equal(ast, entry.node, node)) {
+            ast->count--; // node is the last one added
+            ast->shared = 1;
+            return entry.node;
+        }
+        slot = (slot + 1) & (table->slot_count - 1);
+    }
+    table->slots[slot] = (ConsEntry){node, scope};
+    table->count++;
+    return node;
+}
+
+void parser_cons_enter(ParserState* parser) {
+    ConsTable* table = parser->cons;
+    if (table->depth == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 16;
+        uint32_t* scopes = realloc(table->scopes, capacity * sizeof(uint32_t));
+        if (!scopes) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+        table->scopes = scopes;
+        table->capacity = capacity;
+    }
+    table->scopes[table->depth++] = table->scope;
+    table->scope = ++table->next_scope;
+}
+
+void parser_cons_leave(ParserState* parser) {
+    ConsTable* table = parser->cons;
+    if (table->depth) table->scope = table->scopes[--table->depth];
+}
+
+void parser_cons_declare(ParserState* parser) {
+    parser->cons->scope = ++parser->cons->next_scope;
+}
+
+void parser_cons_reset(ParserState* parser) {
+    ConsTable* table = parser->cons;
+    if (table->count) memset(table->slots, 0, table->slot_count * sizeof(ConsEntry));
+    table->count = 0;
+    table->scope = table->next_scope = 0;
+    table->depth = 0;
+}
+
+void parser_set_hash_consing(ParserState* parser, int enabled) {
+    if (!enabled) {
+        if (parser->cons) {
+            free(parser->cons->slots);
+            free(parser->cons->scopes);
+            free(parser->cons);
+        }
+        parser->cons = NULL;
+        return;
+    }
+    if (parser->cons) return;
+    parser->cons = calloc(1, sizeof(ConsTable));
+    if (!parser->cons) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+}
@@ -0,0 +1,251 @@
+/* parser_incremental.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/parser.h"
+#include "../../include/parser_internal.h"
+
+/* Re-parsing after lex_edit.
+ * A statement of a program or block is parsed from its own tokens alone and stops on the token after its
+ * last one, so only the statements the edited tokens fall in (or stopped on) can parse differently.
+ * 1. From the program, the walk goes down into the block of the statement holding the edit as long as the
+ *    block's braces are outside the edited tokens. Statements keep no end: a statement ends where the next
+ *    one in its sequence starts, the last one where the sequence does, and an if, else or while parsed
+ *    without errors ends where its body does.
+ * 2. The statements of the innermost such block are parsed again from the first one the edit touches, until
+ *    one ends where an old statement past the edit starts. That statement and the ones after it are kept.
+ * 3. A block that now closes on another `}` pairs its braces differently, the enclosing sequence is parsed
+ *    again instead. The program always works.
+ * 4. The new statements are added after the old nodes and replace the old ones in the sequence, which are
+ *    left unreachable. Kept nodes and errors past the edit have their token indices moved.
+ * Once unreachable nodes and statement slots outnumber the live ones the whole buffer is parsed again, so the
+ * tree stays within twice its size and the full parse is paid for by the edits that led to it. */
+
+// A sequence on the way down, its tokens are indices in the old buffer
+typedef struct {
+    NodeId node;
+    size_t first;               // First token of its first statement
+    size_t close;               // Token it ended on: the `}` of a block, TOKEN_EOF for the program
+    int loops;                  // While bodies it sits in, so a break in it parses as it did
+} Level;
+
+// First token of a statement of a sequence, declarations are kept under their identifier
+static size_t statement_start(const Ast *ast, NodeId statement) {
+    ASTNodeType kind = ast_kind(ast, statement);
+    return kind == AST_INT || kind == AST_STRINGCHAR ? ast->token[statement] - 1 : ast->token[statement];
+}
+
+// Number of statements of sequence starting before token
+static uint32_t statements_before(const Ast *ast, NodeId sequence, size_t token) {
+    uint32_t low = 0, high = ast_child_count(ast, sequence);
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (statement_start(ast, ast_child(ast, sequence, mid)) < token) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Statement the edit starts in, the one before it stops on its first token
+static uint32_t first_touched(const Ast *ast, NodeId sequence, size_t token) {
+    uint32_t before = statements_before(ast, sequence, token);
+    return before ? before - 1 : 0;
+}
+
+// Block a statement ends with, NODE_NONE when it is not known to end with one
+// Every while on the way to it is counted in loops
+static NodeId closing_block(const Ast *ast, NodeId statement, int *loops) {
+    while (1) {
+        switch (ast_kind(ast, statement)) {
+            case AST_WHILE:
+                (*loops)++;
+                // fall through
+            case AST_IF:
+            case AST_ELSE:
+                statement = ast_right(ast, statement);
+                if (statement == NODE_NONE) return NODE_NONE;
+                break;
+            case AST_BLOCK:
+                return statement;
+            default:
+                return NODE_NONE;
+        }
+    }
+}
+
+// Only a statement that failed on its first token records an error there, and keeps nothing it parsed
+static int fails_at_start(const Ast *ast, NodeId statement) {
+    return ast_kind(ast, statement) == AST_ERROR && ast_left(ast, statement) == NODE_NONE;
+}
+
+// Index of the first of the count old errors recorded past token
+static size_t diagnostics_after(const ParserState *parser, size_t count, size_t token) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (parser->diagnostics[mid].token <= token) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Errors at the first token of a statement come from the statement before (it stopped there) and then from
+// the statement itself, returns the index of the first one recorded by statement or after it
+static size_t diagnostics_from(const ParserState *parser, size_t count, NodeId statement) {
+    const Ast *ast = &parser->ast;
+    return diagnostics_after(parser, count, statement_start(ast, statement)) - fails_at_start(ast, statement);
+}
+
+// Put the errors recorded since count in place of old ones [from, to), moving the ones after by shift
+static void replace_diagnostics(ParserState *parser, size_t count, size_t from, size_t to, size_t shift) {
+    size_t added = parser->diagnostic_count - count;
+    ParseDiagnostic *recorded = NULL;
+    if (added) {
+        recorded = malloc(added * sizeof(ParseDiagnostic));
+        if (!recorded) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+        memcpy(recorded, parser->diagnostics + count, added * sizeof(ParseDiagnostic));
+    }
+    if (to < count) {
+        memmove(parser->diagnostics + from + added, parser->diagnostics + to, (count - to) * sizeof(ParseDiagnostic));
+    }
+    if (added) memcpy(parser->diagnostics + from, recorded, added * sizeof(ParseDiagnostic));
+    free(recorded);
+    parser->diagnostic_count = count - (to - from) + added;
+    for (size_t i = from + added; i < parser->diagnostic_count; i++) parser->diagnostics[i].token += (uint32_t)shift;
+}
+
+/* Parse the statements of level the edit touches again, old tokens from removed on sit shift later.
+ * Returns 0 and leaves everything as it was when level is a block that no longer closes where it did. */
+static int reparse_level(ParserState *parser, const Level *level, size_t first_token, size_t removed, size_t shift) {
+    Ast *ast = &parser->ast;
+    NodeId sequence = level->node;
+    uint32_t count = ast_child_count(ast, sequence);
+    uint32_t first = first_touched(ast, sequence, first_token);
+    uint32_t kept = statements_before(ast, sequence, removed); // First old statement that can be kept
+    if (kept < first) kept = first;
+    int block = ast_kind(ast, sequence) == AST_BLOCK;
+
+    size_t nodes = ast->count;
+    size_t children = ast->child_count;
+    size_t diagnostics = parser->diagnostic_count;
+    parser->index = first < count ? statement_start(ast, ast_child(ast, sequence, first)) : level->first;
+    parser->panic = 0;
+    parser->loops = level->loops;
+    parser->statement_count = 0;
+    while (1) {
+        if (match(parser, TOKEN_EOF) || (block && match(parser, TOKEN_RIGHTBRACE))) {
+            if (block && (!match(parser, TOKEN_RIGHTBRACE) || parser->index != level->close + shift)) {
+                ast->count = nodes;
+                ast->child_count = children;
+                parser->diagnostic_count = diagnostics;
+                parser->statement_count = 0;
+                parser->loops = 0;
+                return 0;
+            }
+            kept = count;
+            break;
+        }
+        parse_top_level(parser, parser->index + 1); // One statement
+        while (kept < count && statement_start(ast, ast_child(ast, sequence, kept)) + shift < parser->index) kept++;
+        if (kept < count && statement_start(ast, ast_child(ast, sequence, kept)) + shift == parser->index) break;
+    }
+
+    // Errors of the replaced statements, found while the tokens of the old nodes are still unmoved
+    size_t to = kept < count ? diagnostics_from(parser, diagnostics, ast_child(ast, sequence, kept))
+              : block ? diagnostics_after(parser, diagnostics, level->close) : diagnostics;
+    size_t from = first < count ? diagnostics_from(parser, diagnostics, ast_child(ast, sequence, first)) : to;
+    replace_diagnostics(parser, diagnostics, from, to, shift);
+    if (shift != 0) {
+        for (NodeId i = 1; i < nodes; i++) {
+            if (ast->token[i] >= removed) ast->token[i] += (uint32_t)shift;
+        }
+    }
+
+    // Same number of statements: written over the old ones, otherwise the sequence gets a new list
+    // The replaced nodes are counted as stale by the size of what replaced them
+    size_t added = parser->statement_count;
+    if (added == kept - first) {
+        for (size_t i = 0; i < added; i++) ast->children[ast->left[sequence] + first + i] = parser->statements[i];
+        parser->stale += ast->count - nodes + ast->child_count - children;
+    } else {
+        for (uint32_t i = 0; i < first; i++) push_statement(parser, ast_child(ast, sequence, i));
+        for (size_t i = 0; i < added; i++) push_statement(parser, parser->statements[i]);
+        for (uint32_t i = kept; i < count; i++) push_statement(parser, ast_child(ast, sequence, i));
+        parser->stale += ast->count - nodes + ast->child_count - children + count;
+        end_sequence(parser, sequence, added);
+    }
+    parser->statement_count = 0;
+    parser->loops = 0;
+    return 1;
+}
+
+/* --- DRIVER --- */
+NodeId parse_edit(ParserState *parser, NodeId root, const TokenEdit *edit) {
+    if (edit->removed == 0 && edit->inserted == 0) return root;
+    if (parser->cons) {
+        // A shared node sits under statements on both sides of the edit, its token can't follow both
+        parser_reset(parser);
+        return parse(parser);
+    }
+    Ast *ast = &parser->ast;
+    size_t first_token = edit->first;
+    size_t removed = edit->first + edit->removed;
+    size_t shift = edit->inserted - edit->removed; // Wraps for a shrinking edit, unsigned sums still come out right
+    size_t eof = parser->tokens->count - 1 - shift;
+
+    // Walk down to the innermost block holding the edit
+    Level *levels = NULL;
+    size_t depth = 0, capacity = 0;
+    Level level = {root, ast->token[root], eof, 0};
+    while (1) {
+        if (depth == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            Level *grown = realloc(levels, capacity * sizeof(Level));
+            if (!grown) {
+                printf("Memory allocation failed.\n");
+                exit(1);
+            }
+            levels = grown;
+        }
+        levels[depth++] = level;
+
+        // The edit has to fall in one statement ending with a block, and inside that block's braces
+        NodeId sequence = level.node;
+        uint32_t count = ast_child_count(ast, sequence);
+        uint32_t first = first_touched(ast, sequence, first_token);
+        if (statements_before(ast, sequence, removed) != first + 1) break;
+        NodeId statement = ast_child(ast, sequence, first);
+        int loops = level.loops;
+        NodeId block = closing_block(ast, statement, &loops);
+        if (block == NODE_NONE) break;
+        size_t end = first + 1 < count ? statement_start(ast, ast_child(ast, sequence, first + 1)) : level.close;
+        size_t open = ast->token[block];
+        size_t close = end - 1;
+        if (open >= first_token || close < removed) break;
+        if (parser->tokens->types[close + shift] != TOKEN_RIGHTBRACE) break;
+        level = (Level){block, open + 1, close, loops};
+    }
+
+    // Innermost first, a block that closes elsewhere now is given up for the sequence around it
+    // The program sits on the first token whatever it is, so it is not moved with the tokens
+    while (!reparse_level(parser, &levels[--depth], first_token, removed, shift)) {}
+    ast->token[root] = (uint32_t)levels[0].first;
+    free(levels);
+    parser->index = parser->tokens->count - 1;
+
+    if (parser->stale * 2 > ast->count + ast->child_count) {
+        parser_reset(parser);
+        root = parse(parser);
+    }
+    return root;
+}
@@ -0,0 +1,346 @@
+/* parser_iter.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../include/parser.h"
+#include "../../include/parser_internal.h"
+
+/* Explicit-stack parser
+ * Runs the grammar of parser.c as a loop over a stack of frames. A frame is a production waiting on a
+ * sub-statement or sub-expression, the same thing a call of the recursive parser waits on, and it is
+ * resumed with the finished child when that is done. Nodes are created in the same order as the
+ * recursive parser, so both give identical trees and errors, only the nesting limit differs. */
+
+typedef enum {
+    FRAME_SEQUENCE,             // Program or block, value is its first queued statement, start the first token of
+                                // the statement being parsed, flag holds SEQUENCE_BLOCK and SEQUENCE_PANIC
+    FRAME_ASSIGN,               // Assignment waiting on its value
+    FRAME_IF_CONDITION,
+    FRAME_IF_BODY,
+    FRAME_ELSE_BODY,
+    FRAME_WHILE_CONDITION,
+    FRAME_WHILE_BODY,
+    FRAME_REPEAT_BODY,
+    FRAME_REPEAT_CONDITION,
+    FRAME_PRINT,
+    FRAME_FACTORIAL,            // flag set inside an expression, which skips the token after `)` as well
+    FRAME_PARENTHESES,
+    FRAME_OPERAND,              // Expression waiting on a nested first operand, flag is its minimum precedence
+    FRAME_OPERATOR              // Binary operator waiting on its right operand, node is the left one, value the operator token
+} FrameKind;
+
+#define SEQUENCE_BLOCK 1        // Ends at `}` rather than at the end of input
+#define SEQUENCE_PANIC 2        // Panic mode the sequence was entered in, restored after each of its statements
+
+struct ParseFrame {
+    uint8_t kind;
+    uint8_t flag;
+    NodeId node;
+    uint32_t value;
+    uint32_t start;
+};
+
+typedef struct ParseFrame ParseFrame;
+
+// What the loop does next
+typedef enum {
+    STEP_STATEMENT,             // Start a statement at the current token
+    STEP_EXPRESSION,            // Start an expression binding at least as tight as precedence
+    STEP_OPERAND,               // Result is an operand of that expression, apply its postfix operators
+    STEP_BINARY,                // Result is the left side so far, join it with the binary operators that follow
+    STEP_SEQUENCE,              // Parse the next statement of the sequence on top, or close it
+    STEP_RETURN                 // Hand the finished node to the frame on top
+} Step;
+
+// Frames are kept in the parser between parses, so only the first deep parse allocates
+__attribute__((cold, noinline))
+static ParseFrame *grow_frames(ParserState *parser) {
+    size_t capacity = parser->frame_capacity ? parser->frame_capacity * 2 : 64;
+    ParseFrame *frames = realloc(parser->frames, capacity * sizeof(ParseFrame));
+    if (!frames) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+    parser->frames = frames;
+    parser->frame_capacity = capacity;
+    return frames;
+}
+
+// The stack pointer and depth live in locals of parse_iterative so the loop keeps them in registers
+#define PUSH_FRAME(kind_, flag_, node_, value_) do { \
+        if (count == parser->frame_capacity) frames = grow_frames(parser); \
+        frames[count].kind = (uint8_t)(kind_); \
+        frames[count].flag = (uint8_t)(flag_); \
+        frames[count].node = (node_); \
+        frames[count].value = (uint32_t)(value_); \
+        count++; \
+    } while (0)
+
+// Statement ends with a semicolon
+static void end_statement(ParserState *parser) {
+    if (!match(parser, TOKEN_SEMICOLON)) {
+        parse_error(parser, PARSE_ERROR_MISSING_SEMICOLON);
+        return;
+    }
+    advance(parser);
+}
+
+NodeId parse_iterative(ParserState *parser) {
+    ParseFrame *frames = parser->frames;
+    size_t count = 0;
+    int precedence = 1;         // Minimum precedence of the expression STEP_EXPRESSION starts
+    NodeId result = NODE_NONE;
+    NodeId node;
+    Step step = STEP_SEQUENCE;
+    PUSH_FRAME(FRAME_SEQUENCE, parser->panic ? SEQUENCE_PANIC : 0, create_node(parser, AST_PROGRAM), parser->statement_count);
+
+    while (1) {
+        switch (step) {
+            case STEP_SEQUENCE: {
+                ParseFrame frame = frames[count - 1];
+                if (match(parser, TOKEN_EOF) || ((frame.flag & SEQUENCE_BLOCK) && match(parser, TOKEN_RIGHTBRACE))) {
+                    count--;
+                    end_sequence(parser, frame.node, frame.value);
+                    if (frame.flag & SEQUENCE_BLOCK) {
+                        cons_leave_block(parser);
+                        if (match(parser, TOKEN_RIGHTBRACE)) {
+                            advance(parser); // consume } symbol
+                        } else {
+                            parse_error(parser, PARSE_ERROR_MISSING_BRACE);
+                        }
+                    }
+                    if (count == 0) return frame.node;
+                    result = frame.node;
+                    step = STEP_RETURN;
+                    break;
+                }
+                // Panic mode of an enclosing statement does not hide the errors of this one
+                frames[count - 1].start = (uint32_t)parser->index;
+                parser->panic = 0;
+            }
+            // fall through
+            case STEP_STATEMENT:
+                step = STEP_RETURN;
+                switch (peek(parser, 0)) {
+                    case TOKEN_INT: case TOKEN_CHAR: case TOKEN_STRING:
+                        result = parse_declaration(parser);
+                        break;
+                    case TOKEN_IDENTIFIER:
+                        result = create_node(parser, AST_ASSIGN);
+                        set_left(parser, result, create_node(parser, AST_IDENTIFIER));
+                        advance(parser);
+                        if (!match(parser, TOKEN_EQUALS)) {
+                            parse_error(parser, PARSE_ERROR_MISSING_EQUALS);
+                            break;
+                        }
+                        advance(parser);
+                        if (match(parser, TOKEN_STRING) || match(parser, TOKEN_CHAR) || match(parser, TOKEN_NULL)) {
+                            set_right(parser, result, create_node(parser, match(parser, TOKEN_NULL) ? AST_NULL : AST_STRINGCHAR));
+                            advance(parser);
+                            end_statement(parser);
+                            break;
+                        }
+                        PUSH_FRAME(FRAME_ASSIGN, 0, result, 0);
+                        if (match(parser, TOKEN_FACTORIAL)) {
+                            node = create_node(parser, AST_FACTORIAL);
+                            advance(parser); // consume factorial symbol $
+                            expect(parser, TOKEN_LEFTPARENTHESES);
+                            PUSH_FRAME(FRAME_FACTORIAL, 0, node, 0);
+                        }
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    case TOKEN_IF:
+                    case TOKEN_WHILE:
+                        node = create_node(parser, match(parser, TOKEN_IF) ? AST_IF : AST_WHILE);
+                        PUSH_FRAME(match(parser, TOKEN_IF) ? FRAME_IF_CONDITION : FRAME_WHILE_CONDITION, 0, node, 0);
+                        advance(parser);
+                        expect(parser, TOKEN_LEFTPARENTHESES);
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    case TOKEN_ELSE:
+                    case TOKEN_REPEAT:
+                        node = create_node(parser, match(parser, TOKEN_ELSE) ? AST_ELSE : AST_REPEAT);
+                        PUSH_FRAME(match(parser, TOKEN_ELSE) ? FRAME_ELSE_BODY : FRAME_REPEAT_BODY, 0, node, 0);
+                        if (match(parser, TOKEN_REPEAT)) parser->loops++;
+                        advance(parser);
+                        step = STEP_STATEMENT;
+                        break;
+                    case TOKEN_PRINT:
+                        PUSH_FRAME(FRAME_PRINT, 0, create_node(parser, AST_PRINT), 0);
+                        advance(parser);
+                        expect(parser, TOKEN_LEFTPARENTHESES);
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    case TOKEN_BREAK:
+                        if (parser->loops == 0) {
+                            parse_error(parser, PARSE_ERROR_BREAK_OUTSIDE_LOOP);
+                            result = create_node(parser, AST_ERROR);
+                            advance(parser);
+                            break;
+                        }
+                        result = create_node(parser, AST_BREAK);
+                        advance(parser); // consume break keyword
+                        end_statement(parser);
+                        break;
+                    case TOKEN_LEFTBRACE:
+                        PUSH_FRAME(FRAME_SEQUENCE, SEQUENCE_BLOCK | (parser->panic ? SEQUENCE_PANIC : 0),
+                                   create_node(parser, AST_BLOCK), parser->statement_count);
+                        advance(parser); // consume { symbol
+                        cons_enter_block(parser);
+                        step = STEP_SEQUENCE;
+                        break;
+                    default:
+                        parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN);
+                        result = create_node(parser, AST_ERROR);
+                }
+                if (step != STEP_EXPRESSION) break;
+                // fall through
+            case STEP_EXPRESSION:
+                // Literals and names finish on the spot, only nested expressions need a frame to come back to
+                step = STEP_OPERAND;
+                switch (peek(parser, 0)) {
+                    case TOKEN_NUMBER:
+                        result = cons_node(parser, create_node(parser, AST_NUMBER));
+                        advance(parser);
+                        break;
+                    case TOKEN_IDENTIFIER:
+                        result = cons_node(parser, create_node(parser, AST_IDENTIFIER));
+                        advance(parser);
+                        break;
+                    case TOKEN_STRING_LITERAL:
+                    case TOKEN_CHAR_LITERAL:
+                        result = cons_node(parser, create_node(parser, AST_STRINGCHAR));
+                        advance(parser);
+                        break;
+                    case TOKEN_FACTORIAL:
+                        PUSH_FRAME(FRAME_OPERAND, precedence, NODE_NONE, 0);
+                        PUSH_FRAME(FRAME_FACTORIAL, 1, create_node(parser, AST_FACTORIAL), 0);
+                        advance(parser); // consume factorial symbol $
+                        expect(parser, TOKEN_LEFTPARENTHESES);
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    case TOKEN_LEFTPARENTHESES:
+                        PUSH_FRAME(FRAME_OPERAND, precedence, NODE_NONE, 0);
+                        PUSH_FRAME(FRAME_PARENTHESES, 0, NODE_NONE, 0);
+                        advance(parser);
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    default:
+                        parse_error(parser, PARSE_ERROR_INVALID_EXPRESSION);
+                        result = create_node(parser, AST_ERROR);
+                }
+                if (step != STEP_OPERAND) break;
+                // fall through
+            case STEP_OPERAND:
+                // Postfix ! binds tighter than every binary operator
+                while (match(parser, TOKEN_NOT)) {
+                    node = create_node(parser, AST_UNARYOP);
+                    advance(parser);
+                    set_left(parser, node, result);
+                    result = cons_node(parser, node);
+                }
+                // fall through
+            case STEP_BINARY: {
+                // Precedence climbing as in parse_binary, the right operand of a left associative
+                // operator binds one level tighter so this expression picks up the next operator
+                OperatorInfo info = parser_binary_operators[peek(parser, 0)];
+                if (info.precedence == 0 || info.precedence < precedence) {
+                    step = STEP_RETURN;
+                    break;
+                }
+                PUSH_FRAME(FRAME_OPERATOR, precedence, result, parser->index);
+                advance(parser);
+                precedence = info.right_associative ? info.precedence : info.precedence + 1;
+                step = STEP_EXPRESSION;
+                break;
+            }
+
+            case STEP_RETURN: {
+                ParseFrame frame = frames[--count];
+                switch ((FrameKind)frame.kind) {
+                    case FRAME_SEQUENCE:
+                        // Statement of the sequence is done, the sequence stays open
+                        count++;
+                        if (parser->panic) result = parser_recover_statement(parser, result, frame.start);
+                        push_statement(parser, result);
+                        parser->panic = (frame.flag & SEQUENCE_PANIC) != 0;
+                        step = STEP_SEQUENCE;
+                        break;
+                    case FRAME_ASSIGN:
+                        set_right(parser, frame.node, result);
+                        end_statement(parser);
+                        result = frame.node;
+                        break;
+                    case FRAME_IF_CONDITION:
+                    case FRAME_WHILE_CONDITION:
+                        set_left(parser, frame.node, result);
+                        expect(parser, TOKEN_RIGHTPARENTHESES);
+                        PUSH_FRAME(frame.kind == FRAME_IF_CONDITION ? FRAME_IF_BODY : FRAME_WHILE_BODY, 0, frame.node, 0);
+                        if (frame.kind == FRAME_WHILE_CONDITION) parser->loops++;
+                        step = STEP_STATEMENT;
+                        break;
+                    case FRAME_WHILE_BODY:
+                        parser->loops--;
+                        // fall through
+                    case FRAME_IF_BODY:
+                    case FRAME_ELSE_BODY:
+                        set_right(parser, frame.node, result);
+                        result = frame.node;
+                        break;
+                    case FRAME_REPEAT_BODY:
+                        parser->loops--;
+                        set_right(parser, frame.node, result);
+                        result = frame.node;
+                        if (!match(parser, TOKEN_UNTIL)) {
+                            parse_error(parser, PARSE_ERROR_UNEXPECTED_TOKEN);
+                            break;
+                        }
+                        advance(parser); // consume until keyword
+                        expect(parser, TOKEN_LEFTPARENTHESES);
+                        PUSH_FRAME(FRAME_REPEAT_CONDITION, 0, frame.node, 0);
+                        precedence = 1;
+                        step = STEP_EXPRESSION;
+                        break;
+                    case FRAME_REPEAT_CONDITION:
+                        set_left(parser, frame.node, result);
+                        expect(parser, TOKEN_RIGHTPARENTHESES);
+                        expect(parser, TOKEN_SEMICOLON);
+                        result = frame.node;
+                        break;
+                    case FRAME_PRINT:
+                        set_left(parser, frame.node, result);
+                        expect(parser, TOKEN_RIGHTPARENTHESES);
+                        end_statement(parser);
+                        result = frame.node;
+                        break;
+                    case FRAME_FACTORIAL:
+                        set_left(parser, frame.node, result);
+                        expect(parser, TOKEN_RIGHTPARENTHESES);
+                        if (frame.flag) advance(parser);
+                        result = frame.node;
+                        break;
+                    case FRAME_PARENTHESES:
+                        expect(parser, TOKEN_RIGHTPARENTHESES);
+                        break;
+                    case FRAME_OPERAND:
+                        precedence = frame.flag;
+                        step = STEP_OPERAND;
+                        break;
+                    case FRAME_OPERATOR:
+                        node = create_node_at(parser, AST_BINOP, frame.value);
+                        set_left(parser, node, frame.node);
+                        set_right(parser, node, result);
+                        result = cons_node(parser, node);
+                        precedence = frame.flag;
+                        step = STEP_BINARY;
+                        break;
+                }
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,212 @@
+/* parser_parallel.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../../include/parser.h"
+#include "../../include/parser_internal.h"
+
+/* Parallel parsing of top level statements.
+ * 1. Pre-scan: one pass over the token types tracks brace depth and cuts the buffer after a `;` or `}` at
+ *    depth 0, one cut per thread past an even share of the tokens. A cut is never made before `until`,
+ *    which continues the repeat statement before it.
+ * 2. Every chunk is parsed on its own thread by a worker ParserState, with its own node arrays, statement
+ *    queue and diagnostics, using the same top level loop as parse(). The workers are kept in the parser
+ *    and reset for the next parse, so their arrays are only allocated once.
+ * 3. The seams are checked in order. A top level statement always starts outside panic mode, so a chunk
+ *    that starts where the previous one stopped parses exactly as parse() would have. A statement can only
+ *    run past a cut in malformed input, and the chunk after it is then parsed again from the real stop.
+ * 4. The worker trees are copied into the parser's Ast in parallel after the program node, each shifted by
+ *    the nodes before it, and the top level statements become the program's children. That is the node
+ *    numbering and children layout parse() builds, so both give identical trees and diagnostics.
+ * Small buffers are parsed on the calling thread, and so is any buffer while hash-consing is on: a chunk
+ * would share equal expressions only within itself, which is not the tree parse() builds. */
+
+// Buffers with fewer tokens than this per thread are not worth splitting
+#define MIN_CHUNK_TOKENS (32 * 1024)
+#define MAX_THREADS 64
+
+typedef struct ParseWorkers {
+    ParserState parsers[MAX_THREADS];
+    int count;                  // Parsers initialized so far
+} ParseWorkers;
+
+typedef struct {
+    ParserState* parser;        // Worker, parses the chunk into its own Ast
+    size_t start;               // First token of the chunk
+    size_t end;                 // Token the chunk is cut at, the last chunk runs to the end of input
+    NodeId node;                // Where the chunk's first node lands in the stitched tree
+    size_t child;               // Where its statement lists land
+} Chunk;
+
+typedef struct {
+    Chunk* chunks;
+    Ast* out;
+    int count;
+    int stride;
+    int index;
+} Job;
+
+static void chunk_parse(Chunk* chunk) {
+    chunk->parser->index = chunk->start;
+    parse_top_level(chunk->parser, chunk->end);
+}
+
+static void* parse_job(void* arg) {
+    Job* job = arg;
+    for (int i = job->index; i < job->count; i += job->stride) chunk_parse(&job->chunks[i]);
+    return NULL;
+}
+
+static void* copy_job(void* arg) {
+    Job* job = arg;
+    for (int i = job->index; i < job->count; i += job->stride) {
+        Chunk* chunk = &job->chunks[i];
+        ast_copy(job->out, chunk->node, chunk->child, &chunk->parser->ast);
+    }
+    return NULL;
+}
+
+// Runs fn on `threads` jobs, job 0 on the calling thread
+static void run_jobs(void* (*fn)(void*), Job* jobs, int threads) {
+    pthread_t ids[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+    for (int i = 1; i < threads; i++) {
+        started[i] = pthread_create(&ids[i], NULL, fn, &jobs[i]) == 0;
+        if (!started[i]) fn(&jobs[i]);
+    }
+    fn(&jobs[0]);
+    for (int i = 1; i < threads; i++) {
+        if (started[i]) pthread_join(ids[i], NULL);
+    }
+}
+
+// Cuts the tokens from start into at most `threads` chunks at top level statement boundaries, returns the chunk count
+static int find_cuts(const TokenBuffer* tokens, size_t start, int threads, Chunk* chunks) {
+    const uint8_t* types = tokens->types;
+    size_t last = tokens->count - 1; // TOKEN_EOF
+    size_t share = (last - start) / threads;
+    size_t target = start + share;
+    size_t depth = 0;
+    int count = 0;
+    chunks[0].start = start;
+    for (size_t i = start; i < last && count + 1 < threads; i++) {
+        if (types[i] == TOKEN_LEFTBRACE) {
+            depth++;
+            continue;
+        }
+        if (types[i] == TOKEN_RIGHTBRACE && depth > 0) depth--;
+        else if (types[i] != TOKEN_SEMICOLON) continue;
+        if (depth == 0 && i + 1 >= target && types[i + 1] != TOKEN_UNTIL) {
+            chunks[count].end = i + 1;
+            chunks[++count].start = i + 1;
+            target = i + 1 + share;
+        }
+    }
+    chunks[count++].end = SIZE_MAX;
+    return count;
+}
+
+// Diagnostics of a chunk after the ones already recorded, dropped when out of memory like parser_record_error does
+static void append_diagnostics(ParserState* parser, const ParserState* from) {
+    size_t needed = parser->diagnostic_count + from->diagnostic_count;
+    if (needed > parser->diagnostic_capacity) {
+        ParseDiagnostic* diagnostics = realloc(parser->diagnostics, needed * sizeof(ParseDiagnostic));
+        if (!diagnostics) return;
+        parser->diagnostics = diagnostics;
+        parser->diagnostic_capacity = needed;
+    }
+    for (size_t i = 0; i < from->diagnostic_count; i++) {
+        parser->diagnostics[parser->diagnostic_count++] = from->diagnostics[i];
+    }
+}
+
+/* --- DRIVER --- */
+NodeId parse_parallel(ParserState* parser, int threads) {
+    TokenBuffer* tokens = parser->tokens;
+    size_t remaining = tokens->count - parser->index;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads > (int)(remaining / MIN_CHUNK_TOKENS)) threads = (int)(remaining / MIN_CHUNK_TOKENS);
+    if (threads <= 1 || parser->cons) return parse(parser);
+
+    Chunk chunks[MAX_THREADS];
+    Job jobs[MAX_THREADS];
+    int chunk_count = find_cuts(tokens, parser->index, threads, chunks);
+    if (!parser->workers) {
+        parser->workers = malloc(sizeof(ParseWorkers));
+        if (!parser->workers) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+        parser->workers->count = 0;
+    }
+    ParseWorkers* workers = parser->workers;
+    for (int i = 0; i < chunk_count; i++) {
+        if (i == workers->count) parser_init(&workers->parsers[workers->count++], tokens);
+        ParserState* worker = &workers->parsers[i];
+        worker->tokens = tokens;
+        worker->ast.tokens = tokens;
+        parser_reset(worker);
+        chunks[i].parser = worker;
+        // Size the worker's arrays from its share so it does not start from the whole buffer's size
+        size_t share = (i + 1 < chunk_count ? chunks[i].end : tokens->count) - chunks[i].start;
+        if (!ast_reserve(&worker->ast, share + 1, share / 2 + 1)) {
+            printf("Memory allocation failed.\n");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < chunk_count; i++) {
+        jobs[i] = (Job){chunks, &parser->ast, chunk_count, chunk_count, i};
+    }
+    run_jobs(parse_job, jobs, chunk_count);
+
+    // Seams: a chunk that does not start where the previous one stopped is parsed again from there
+    for (int i = 1; i < chunk_count; i++) {
+        size_t stop = chunks[i - 1].parser->index;
+        if (chunks[i].start != stop) {
+            parser_reset(chunks[i].parser);
+            chunks[i].start = stop;
+            chunk_parse(&chunks[i]);
+        }
+    }
+
+    // Stitch the chunks after the program node, in the layout parse() gives
+    NodeId program = create_node(parser, AST_PROGRAM);
+    size_t nodes = parser->ast.count;
+    size_t children = parser->ast.child_count;
+    size_t statements = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        Ast* ast = &chunks[i].parser->ast;
+        chunks[i].node = (NodeId)nodes;
+        chunks[i].child = children;
+        nodes += ast->count ? ast->count - 1 : 0;
+        children += ast->child_count;
+        statements += chunks[i].parser->statement_count;
+    }
+    if (nodes > UINT32_MAX || !ast_reserve(&parser->ast, nodes, children + statements)) {
+        printf("Memory allocation failed.\n");
+        exit(1);
+    }
+    run_jobs(copy_job, jobs, chunk_count);
+    parser->ast.count = nodes;
+    parser->ast.child_count = children;
+
+    size_t first = parser->statement_count;
+    for (int i = 0; i < chunk_count; i++) {
+        ParserState* worker = chunks[i].parser;
+        for (size_t s = 0; s < worker->statement_count; s++) {
+            push_statement(parser, worker->statements[s] + chunks[i].node - 1);
+        }
+        append_diagnostics(parser, worker);
+    }
+    end_sequence(parser, program, first);
+    parser->index = chunks[chunk_count - 1].parser->index;
+    return program;
+}
+
+void parse_workers_free(ParserState* parser) {
+    if (!parser->workers) return;
+    for (int i = 0; i < parser->workers->count; i++) parser_free(&parser->workers->parsers[i]);
+    free(parser->workers);
+    parser->workers = NULL;
+}
@@ -0,0 +1,304 @@
+/* cfg.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../../include/cfg.h"
+
+/* The statement lists are walked with an explicit stack of frames, so nesting depth is not limited by the C
+ * stack. Items always go to the newest block, so the items of a block are contiguous. Edges are collected as
+ * pairs, jumps to blocks that do not exist yet (past an if, past a loop for a break) are added once the block
+ * is made, and the pairs are sorted into successor and predecessor lists at the end. */
+
+typedef enum {
+    BUILD_SEQUENCE,             // value is the next statement of the sequence
+    BUILD_IF,                   // Body of an if, value is the block its condition ends
+    BUILD_ELSE,                 // Body of an else, value is the block that skips it
+    BUILD_WHILE,                // Body of a while, value is the condition block
+    BUILD_REPEAT                // Body of a repeat, value is its first block
+} BuildKind;
+
+typedef struct {
+    uint8_t kind;
+    NodeId node;
+    uint32_t value;
+    uint32_t breaks;            // Pending breaks when a loop body was entered, the ones above are its own
+} BuildFrame;
+
+typedef struct {
+    BlockId from;
+    BlockId to;
+} Edge;
+
+typedef struct {
+    Cfg* cfg;
+    size_t item_capacity;
+    size_t block_capacity;
+    Edge* edges;
+    size_t edge_capacity;
+    BuildFrame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    BlockId* breaks;            // Blocks ending with a break, waiting for the block past their loop
+    size_t break_count;
+    size_t break_capacity;
+    int loops;                  // Loop bodies being added
+    BlockId current;            // Newest block, where items go
+    int failed;
+} Builder;
+
+// Start a block after the current one, it becomes the current one
+static BlockId new_block(Builder* builder) {
+    Cfg* cfg = builder->cfg;
+    // One entry more than the blocks for the end offset
+    if (cfg->block_count + 1 >= builder->block_capacity) {
+        size_t capacity = builder->block_capacity ? builder->block_capacity * 2 : 64;
+        uint32_t* block_items = realloc(cfg->block_items, capacity * sizeof(uint32_t));
+        if (!block_items) {
+            builder->failed = 1;
+            return builder->current;
+        }
+        cfg->block_items = block_items;
+        builder->block_capacity = capacity;
+    }
+    cfg->block_items[cfg->block_count] = (uint32_t)cfg->item_count;
+    builder->current = (BlockId)cfg->block_count++;
+    return builder->current;
+}
+
+static void add_item(Builder* builder, NodeId node) {
+    Cfg* cfg = builder->cfg;
+    if (cfg->item_count == builder->item_capacity) {
+        size_t capacity = builder->item_capacity ? builder->item_capacity * 2 : 64;
+        NodeId* items = realloc(cfg->items, capacity * sizeof(NodeId));
+        if (!items) {
+            builder->failed = 1;
+            return;
+        }
+        cfg->items = items;
+        builder->item_capacity = capacity;
+    }
+    cfg->items[cfg->item_count++] = node;
+}
+
+static void add_edge(Builder* builder, BlockId from, BlockId to) {
+    if (builder->cfg->edge_count == builder->edge_capacity) {
+        size_t capacity = builder->edge_capacity ? builder->edge_capacity * 2 : 64;
+        Edge* edges = realloc(builder->edges, capacity * sizeof(Edge));
+        if (!edges) {
+            builder->failed = 1;
+            return;
+        }
+        builder->edges = edges;
+        builder->edge_capacity = capacity;
+    }
+    builder->edges[builder->cfg->edge_count++] = (Edge){from, to};
+}
+
+static void push_frame(Builder* builder, BuildKind kind, NodeId node, uint32_t value) {
+    if (builder->frame_count == builder->frame_capacity) {
+        size_t capacity = builder->frame_capacity ? builder->frame_capacity * 2 : 64;
+        BuildFrame* frames = realloc(builder->frames, capacity * sizeof(BuildFrame));
+        if (!frames) {
+            builder->failed = 1;
+            return;
+        }
+        builder->frames = frames;
+        builder->frame_capacity = capacity;
+    }
+    builder->frames[builder->frame_count++] = (BuildFrame){(uint8_t)kind, node, value, (uint32_t)builder->break_count};
+}
+
+// Block ending with a break, it jumps past its loop once the loop is added
+static void push_break(Builder* builder, BlockId block) {
+    if (builder->break_count == builder->break_capacity) {
+        size_t capacity = builder->break_capacity ? builder->break_capacity * 2 : 64;
+        BlockId* breaks = realloc(builder->breaks, capacity * sizeof(BlockId));
+        if (!breaks) {
+            builder->failed = 1;
+            return;
+        }
+        builder->breaks = breaks;
+        builder->break_capacity = capacity;
+    }
+    builder->breaks[builder->break_count++] = block;
+}
+
+// Block past a loop, every break of the loop jumps to it
+static void leave_loop(Builder* builder, const BuildFrame* frame, BlockId condition) {
+    BlockId past = new_block(builder);
+    add_edge(builder, condition, past);
+    while (builder->break_count > frame->breaks) add_edge(builder, builder->breaks[--builder->break_count], past);
+    builder->loops--;
+}
+
+// Add a statement, returns the statement to add next: the body of a control statement, NODE_NONE otherwise
+static NodeId start_statement(Builder* builder, NodeId node) {
+    const Ast* ast = builder->cfg->ast;
+    BlockId before = builder->current;
+    switch (ast_kind(ast, node)) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            push_frame(builder, BUILD_SEQUENCE, node, 0);
+            return NODE_NONE;
+        case AST_IF:
+            add_item(builder, node);
+            add_edge(builder, before, new_block(builder));
+            push_frame(builder, BUILD_IF, node, before);
+            return ast_right(ast, node);
+        case AST_ELSE:
+            // Not right after an if, the body may or may not run
+            add_edge(builder, before, new_block(builder));
+            push_frame(builder, BUILD_ELSE, node, before);
+            return ast_right(ast, node);
+        case AST_WHILE: {
+            BlockId condition = new_block(builder);
+            add_edge(builder, before, condition);
+            add_item(builder, node);
+            add_edge(builder, condition, new_block(builder));
+            push_frame(builder, BUILD_WHILE, node, condition);
+            builder->loops++;
+            return ast_right(ast, node);
+        }
+        case AST_REPEAT: {
+            BlockId body = new_block(builder);
+            add_edge(builder, before, body);
+            push_frame(builder, BUILD_REPEAT, node, body);
+            builder->loops++;
+            return ast_right(ast, node);
+        }
+        case AST_BREAK:
+            add_item(builder, node);
+            if (builder->loops == 0) return NODE_NONE; // Rejected by the parser
+            push_break(builder, before);
+            new_block(builder);
+            return NODE_NONE;
+        default:
+            add_item(builder, node);
+            return NODE_NONE;
+    }
+}
+
+// Block where the two branches of an if meet
+static void join(Builder* builder, BlockId first, BlockId second) {
+    BlockId meet = new_block(builder);
+    add_edge(builder, first, meet);
+    add_edge(builder, second, meet);
+}
+
+// The body of the control statement on top is added, returns the statement to add next
+static NodeId finish_statement(Builder* builder) {
+    const Ast* ast = builder->cfg->ast;
+    BuildFrame frame = builder->frames[--builder->frame_count];
+    BlockId end = builder->current;
+    switch ((BuildKind)frame.kind) {
+        case BUILD_IF: {
+            // An else right after the if in the same sequence takes the other branch
+            BuildFrame* sequence = builder->frame_count > 0 ? &builder->frames[builder->frame_count - 1] : NULL;
+            NodeId next = sequence && sequence->kind == BUILD_SEQUENCE
+                          && sequence->value < ast_child_count(ast, sequence->node)
+                          ? ast_child(ast, sequence->node, sequence->value) : NODE_NONE;
+            if (next != NODE_NONE && ast_kind(ast, next) == AST_ELSE) {
+                sequence->value++;
+                add_edge(builder, frame.value, new_block(builder));
+                push_frame(builder, BUILD_ELSE, next, end);
+                return ast_right(ast, next);
+            }
+            join(builder, frame.value, end);
+            return NODE_NONE;
+        }
+        case BUILD_ELSE:
+            join(builder, frame.value, end);
+            return NODE_NONE;
+        case BUILD_WHILE:
+            add_edge(builder, end, frame.value);
+            leave_loop(builder, &frame, frame.value);
+            return NODE_NONE;
+        case BUILD_REPEAT:
+            add_item(builder, frame.node);
+            add_edge(builder, end, frame.value);
+            leave_loop(builder, &frame, end);
+            return NODE_NONE;
+        default:
+            return NODE_NONE;
+    }
+}
+
+// Turn the edge pairs into per-block lists, start gets the offsets and lists the blocks on the other end
+static int edge_lists(const Builder* builder, int forward, uint32_t** start, BlockId** lists) {
+    const Cfg* cfg = builder->cfg;
+    *start = calloc(cfg->block_count + 1, sizeof(uint32_t));
+    *lists = malloc((cfg->edge_count ? cfg->edge_count : 1) * sizeof(BlockId));
+    if (!*start || !*lists) return 0;
+    for (size_t i = 0; i < cfg->edge_count; i++) {
+        (*start)[(forward ? builder->edges[i].from : builder->edges[i].to) + 1]++;
+    }
+    for (size_t b = 0; b < cfg->block_count; b++) (*start)[b + 1] += (*start)[b];
+    // Each list keeps the order its edges were added in, and its offset ends up where the next list starts
+    for (size_t i = 0; i < cfg->edge_count; i++) {
+        const Edge* edge = &builder->edges[i];
+        (*lists)[(*start)[forward ? edge->from : edge->to]++] = forward ? edge->to : edge->from;
+    }
+    for (size_t b = cfg->block_count; b > 0; b--) (*start)[b] = (*start)[b - 1];
+    (*start)[0] = 0;
+    return 1;
+}
+
+int cfg_build(Cfg* cfg, const Ast* ast, NodeId root) {
+    *cfg = (Cfg){0};
+    cfg->ast = ast;
+    Builder builder = {0};
+    builder.cfg = cfg;
+    new_block(&builder);
+
+    NodeId next = root;
+    while (!builder.failed) {
+        if (next != NODE_NONE) {
+            next = start_statement(&builder, next);
+            continue;
+        }
+        if (builder.frame_count == 0) break;
+        BuildFrame* top = &builder.frames[builder.frame_count - 1];
+        if (top->kind != BUILD_SEQUENCE) {
+            next = finish_statement(&builder);
+        } else if (top->value < ast_child_count(ast, top->node)) {
+            next = ast_child(ast, top->node, top->value++);
+        } else {
+            builder.frame_count--;
+        }
+    }
+    BlockId end = builder.current;
+    add_edge(&builder, end, new_block(&builder));
+    if (!builder.failed) cfg->block_items[cfg->block_count] = (uint32_t)cfg->item_count;
+
+    int ok = !builder.failed
+             && edge_lists(&builder, 1, &cfg->successor_start, &cfg->successors)
+             && edge_lists(&builder, 0, &cfg->predecessor_start, &cfg->predecessors);
+    free(builder.edges);
+    free(builder.frames);
+    free(builder.breaks);
+    if (!ok) cfg_free(cfg);
+    return ok;
+}
+
+void cfg_free(Cfg* cfg) {
+    free(cfg->items);
+    free(cfg->block_items);
+    free(cfg->successor_start);
+    free(cfg->successors);
+    free(cfg->predecessor_start);
+    free(cfg->predecessors);
+    *cfg = (Cfg){0};
+}
+
+void print_cfg(const Cfg* cfg) {
+    for (BlockId block = 0; block < cfg->block_count; block++) {
+        printf("Block %u:", block);
+        for (uint32_t i = 0; i < cfg_item_count(cfg, block); i++) {
+            NodeId item = cfg_item(cfg, block, i);
+            printf(" %u@%d", item, ast_location(cfg->ast, item).line);
+        }
+        printf(" ->");
+        for (uint32_t i = 0; i < cfg_successor_count(cfg, block); i++) printf(" %u", cfg_successor(cfg, block, i));
+        printf("\n");
+    }
+}
@@ -0,0 +1,187 @@
+/* dataflow.c */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/dataflow.h"
+
+/* --- BITSETS --- */
+static inline void set_bit(uint64_t* set, uint32_t bit) {
+    set[bit >> 6] |= 1ull << (bit & 63);
+}
+
+static inline void clear_bit(uint64_t* set, uint32_t bit) {
+    set[bit >> 6] &= ~(1ull << (bit & 63));
+}
+
+static inline int test_bit(const uint64_t* set, uint32_t bit) {
+    return (set[bit >> 6] >> (bit & 63)) & 1;
+}
+
+// set &= other, returns whether set changed
+static inline int intersect(uint64_t* set, const uint64_t* other, size_t words) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t met = set[i] & other[i];
+        changed |= set[i] ^ met;
+        set[i] = met;
+    }
+    return changed != 0;
+}
+
+/* --- TRANSFER --- */
+// Whether a value of type can be assigned to a variable declared by declaration
+static int assignable(const Ast* ast, NodeId declaration, ValueType type) {
+    return declared_type(ast, declaration) == TYPE_INT ? type == TYPE_INT : is_text_type(type);
+}
+
+// Apply what item does to the variables to set: a declaration clears its slot, a well typed assignment sets it
+static void transfer(const InitAnalysis* analysis, NodeId item, uint64_t* set) {
+    const Resolution* resolution = analysis->resolution;
+    const Ast* ast = resolution->ast;
+    switch (ast_kind(ast, item)) {
+        case AST_INT:
+        case AST_STRINGCHAR: {
+            const SymbolInfo* symbol = node_symbol_info(resolution, item);
+            if (symbol) clear_bit(set, symbol->slot);
+            break;
+        }
+        case AST_ASSIGN: {
+            const SymbolInfo* symbol = node_symbol_info(resolution, ast_left(ast, item));
+            NodeId value = ast_right(ast, item);
+            if (symbol && value != NODE_NONE && assignable(ast, symbol->declaration, node_type(analysis->types, value))) {
+                set_bit(set, symbol->slot);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Expression item reads: the value of an assignment or print, the condition of a control statement
+static NodeId read_expression(const Ast* ast, NodeId item) {
+    switch (ast_kind(ast, item)) {
+        case AST_ASSIGN:
+            return ast_right(ast, item);
+        case AST_PRINT:
+        case AST_IF:
+        case AST_WHILE:
+        case AST_REPEAT:
+            return ast_left(ast, item);
+        default:
+            return NODE_NONE;
+    }
+}
+
+// Record the names item reads that are not in set, 0 when out of memory
+static int record_uses(InitAnalysis* analysis, NodeId item, const uint64_t* set) {
+    const Ast* ast = analysis->resolution->ast;
+    NodeId expression = read_expression(ast, item);
+    if (expression == NODE_NONE) return 1;
+    int ok = 1;
+    NodeId node;
+    AstWalk walk;
+    ast_walk_begin(&walk, ast, expression, 0);
+    while (ok && ast_walk_next(&walk, &node, NULL)) {
+        if (ast_kind(ast, node) != AST_IDENTIFIER) continue;
+        const SymbolInfo* symbol = node_symbol_info(analysis->resolution, node);
+        if (!symbol || test_bit(set, symbol->slot)) continue;
+        if (analysis->use_count == analysis->use_capacity) {
+            size_t capacity = analysis->use_capacity ? analysis->use_capacity * 2 : 64;
+            UninitializedUse* uses = realloc(analysis->uses, capacity * sizeof(UninitializedUse));
+            if (!uses) {
+                ok = 0;
+                break;
+            }
+            analysis->uses = uses;
+            analysis->use_capacity = capacity;
+        }
+        analysis->uses[analysis->use_count++] = (UninitializedUse){item, node_symbol(analysis->resolution, node)};
+    }
+    if (walk.failed) ok = 0;
+    ast_walk_end(&walk);
+    return ok;
+}
+
+static int compare_uses(const void* a, const void* b) {
+    const UninitializedUse* left = a;
+    const UninitializedUse* right = b;
+    if (left->item != right->item) return left->item < right->item ? -1 : 1;
+    if (left->symbol != right->symbol) return left->symbol < right->symbol ? -1 : 1;
+    return 0;
+}
+
+/* --- SOLVER --- */
+int analyze_initialization(InitAnalysis* analysis, const Cfg* cfg, const Resolution* resolution, const TypeTable* types) {
+    size_t blocks = cfg->block_count;
+    analysis->cfg = cfg;
+    analysis->resolution = resolution;
+    analysis->types = types;
+    analysis->words = resolution->frame_size / 64 + 1;
+    analysis->uses = NULL;
+    analysis->use_count = 0;
+    analysis->use_capacity = 0;
+    analysis->visits = 0;
+    size_t words = analysis->words;
+    analysis->in = malloc(blocks * words * sizeof(uint64_t));
+    uint64_t* set = malloc(words * sizeof(uint64_t));
+    BlockId* queue = malloc(blocks * sizeof(BlockId));   // Ring, a block is queued at most once at a time
+    uint8_t* queued = malloc(blocks);
+    int ok = analysis->in && set && queue && queued;
+
+    if (ok) {
+        // Everything is initialized until a path shows otherwise, nothing is on entry
+        memset(analysis->in, 0xff, blocks * words * sizeof(uint64_t));
+        memset(analysis->in + CFG_ENTRY * words, 0, words * sizeof(uint64_t));
+        for (size_t b = 0; b < blocks; b++) queue[b] = (BlockId)b;
+        memset(queued, 1, blocks);
+        size_t head = 0, count = blocks;
+        while (count > 0) {
+            BlockId block = queue[head];
+            head = head + 1 == blocks ? 0 : head + 1;
+            count--;
+            queued[block] = 0;
+            analysis->visits++;
+            memcpy(set, analysis->in + block * words, words * sizeof(uint64_t));
+            for (uint32_t i = 0; i < cfg_item_count(cfg, block); i++) transfer(analysis, cfg_item(cfg, block, i), set);
+            for (uint32_t i = 0; i < cfg_successor_count(cfg, block); i++) {
+                BlockId next = cfg_successor(cfg, block, i);
+                if (intersect(analysis->in + next * words, set, words) && !queued[next]) {
+                    queued[next] = 1;
+                    queue[(head + count++) % blocks] = next;
+                }
+            }
+        }
+
+        // Replay every block once with its solved entry set
+        for (BlockId block = 0; ok && block < blocks; block++) {
+            memcpy(set, analysis->in + block * words, words * sizeof(uint64_t));
+            for (uint32_t i = 0; ok && i < cfg_item_count(cfg, block); i++) {
+                NodeId item = cfg_item(cfg, block, i);
+                ok = record_uses(analysis, item, set);
+                transfer(analysis, item, set);
+            }
+        }
+        if (ok && analysis->use_count > 0) qsort(analysis->uses, analysis->use_count, sizeof(UninitializedUse), compare_uses);
+    }
+    free(set);
+    free(queue);
+    free(queued);
+    if (!ok) init_analysis_free(analysis);
+    return ok;
+}
+
+void init_analysis_free(InitAnalysis* analysis) {
+    free(analysis->in);
+    free(analysis->uses);
+    analysis->in = NULL;
+    analysis->uses = NULL;
+    analysis->use_count = 0;
+    analysis->use_capacity = 0;
+}
+
+int maybe_uninitialized(const InitAnalysis* analysis, NodeId item, NodeId name) {
+    UninitializedUse key = {item, node_symbol(analysis->resolution, name)};
+    if (key.symbol == SYMBOL_NONE || analysis->use_count == 0) return 0;
+    return bsearch(&key, analysis->uses, analysis->use_count, sizeof(UninitializedUse), compare_uses) != NULL;
+}
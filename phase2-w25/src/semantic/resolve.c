@@ -0,0 +1,159 @@
+/* resolve.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../../include/tokens.h"
+#include "../../include/semantic.h"
+#include "../../include/resolve.h"
+
+/* The tree is walked once in source order with AstWalk, so nesting depth is not limited by the C stack. The
+ * walk gives every node's depth, and a scope opened at some depth is closed when the walk comes back to a
+ * node at that depth or above. Names are looked up in a SymbolTable, whose symbols carry their
+ * SymbolId, and a symbol's frame slot is its position among the live symbols. */
+
+typedef struct {
+    int* scopes;                // Depth of the node that opened each open scope, innermost last
+    size_t scope_count;
+    size_t scope_capacity;
+    NodeId* bodies;             // Statement bodies of the control statements being walked, innermost last
+    size_t body_count;
+    size_t body_capacity;
+} ResolveStack;
+
+// Open a scope at the depth of the node opening it, 0 when out of memory
+static int push_scope(ResolveStack* stack, int depth) {
+    if (stack->scope_count == stack->scope_capacity) {
+        size_t capacity = stack->scope_capacity ? stack->scope_capacity * 2 : 16;
+        int* scopes = realloc(stack->scopes, capacity * sizeof(int));
+        if (!scopes) return 0;
+        stack->scopes = scopes;
+        stack->scope_capacity = capacity;
+    }
+    stack->scopes[stack->scope_count++] = depth;
+    return 1;
+}
+
+// Remember the body of a control statement, it opens a scope when the walk gets to it. 0 when out of memory
+static int push_body(ResolveStack* stack, NodeId body) {
+    if (stack->body_count == stack->body_capacity) {
+        size_t capacity = stack->body_capacity ? stack->body_capacity * 2 : 16;
+        NodeId* bodies = realloc(stack->bodies, capacity * sizeof(NodeId));
+        if (!bodies) return 0;
+        stack->bodies = bodies;
+        stack->body_capacity = capacity;
+    }
+    stack->bodies[stack->body_count++] = body;
+    return 1;
+}
+
+// Declarations sit on their identifier, string and char literals share AST_STRINGCHAR but sit on the literal
+static int is_declaration(const Ast* ast, NodeId node) {
+    ASTNodeType kind = ast_kind(ast, node);
+    return (kind == AST_INT || kind == AST_STRINGCHAR) && ast_token_type(ast, node) == TOKEN_IDENTIFIER;
+}
+
+static int is_control(ASTNodeType kind) {
+    return kind == AST_IF || kind == AST_ELSE || kind == AST_WHILE || kind == AST_REPEAT;
+}
+
+static int declare(Resolution* resolution, SymbolTable* table, NodeId node) {
+    const Ast* ast = resolution->ast;
+    Atom name = ast_atom(ast, node);
+    if (lookup_symbol_current_scope(table, name)) {
+        resolution->redeclared++;
+        return 1;
+    }
+    if (resolution->symbol_count == resolution->symbol_capacity) {
+        size_t capacity = resolution->symbol_capacity ? resolution->symbol_capacity * 2 : 16;
+        SymbolInfo* symbols = realloc(resolution->symbols, capacity * sizeof(SymbolInfo));
+        if (!symbols) return 0;
+        resolution->symbols = symbols;
+        resolution->symbol_capacity = capacity;
+    }
+    SymbolId id = (SymbolId)resolution->symbol_count++;
+    Symbol* symbol = add_symbol(table, name, ast_kind(ast, node));
+    symbol->id = id;
+    uint32_t slot = (uint32_t)table->symbol_count - 1;
+    if (slot + 1 > resolution->frame_size) resolution->frame_size = slot + 1;
+    resolution->symbols[id] = (SymbolInfo){name, node, (uint8_t)ast_kind(ast, node), (uint32_t)table->current_scope, slot};
+    resolution->node_symbols[node] = id;
+    return 1;
+}
+
+static void use(Resolution* resolution, SymbolTable* table, NodeId node) {
+    Symbol* symbol = lookup_symbol(table, ast_atom(resolution->ast, node));
+    if (symbol) {
+        resolution->node_symbols[node] = symbol->id;
+    } else {
+        resolution->unresolved++;
+    }
+}
+
+int resolve_names(Resolution* resolution, const Ast* ast, NodeId root) {
+    resolution->ast = ast;
+    resolution->node_count = ast->count;
+    resolution->node_symbols = malloc(ast->count * sizeof(SymbolId));
+    resolution->symbols = NULL;
+    resolution->symbol_count = 0;
+    resolution->symbol_capacity = 0;
+    resolution->frame_size = 0;
+    resolution->unresolved = 0;
+    resolution->redeclared = 0;
+    SymbolTable* table = init_symbol_table();
+    if (!resolution->node_symbols || !table) {
+        if (table) free_symbol_table(table);
+        resolution_free(resolution);
+        return 0;
+    }
+    for (size_t i = 0; i < ast->count; i++) resolution->node_symbols[i] = SYMBOL_NONE;
+
+    ResolveStack stack = {NULL, 0, 0, NULL, 0, 0};
+    AstWalk walk;
+    NodeId node;
+    int depth;
+    int ok = 1;
+    ast_walk_begin(&walk, ast, root, 0);
+    while (ok && ast_walk_next(&walk, &node, &depth)) {
+        // Every scope opened at this depth or below it is done
+        while (stack.scope_count > 0 && stack.scopes[stack.scope_count - 1] >= depth) {
+            stack.scope_count--;
+            exit_scope(table);
+        }
+        ASTNodeType kind = ast_kind(ast, node);
+        int body = stack.body_count > 0 && stack.bodies[stack.body_count - 1] == node;
+        if (body) stack.body_count--;
+        if (kind == AST_BLOCK || body) {
+            if (!push_scope(&stack, depth)) {
+                ok = 0;
+                break;
+            }
+            enter_scope(table);
+        }
+        if (is_control(kind) && ast_right(ast, node) != NODE_NONE && !push_body(&stack, ast_right(ast, node))) {
+            ok = 0;
+            break;
+        }
+        if (kind == AST_IDENTIFIER) {
+            use(resolution, table, node);
+        } else if (is_declaration(ast, node)) {
+            ok = declare(resolution, table, node);
+        }
+    }
+    if (walk.failed) ok = 0;
+    ast_walk_end(&walk);
+    free(stack.scopes);
+    free(stack.bodies);
+    free_symbol_table(table);
+    if (!ok) resolution_free(resolution);
+    return ok;
+}
+
+void resolution_free(Resolution* resolution) {
+    free(resolution->node_symbols);
+    free(resolution->symbols);
+    resolution->node_symbols = NULL;
+    resolution->symbols = NULL;
+    resolution->node_count = 0;
+    resolution->symbol_count = 0;
+    resolution->symbol_capacity = 0;
+}
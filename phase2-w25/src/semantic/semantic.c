@@ -6,74 +6,107 @@
 #include "../../include/tokens.h"
 #include "../../include/parser.h"
 #include "../../include/semantic.h"
+#include "../../include/source.h"
+#include "../../include/resolve.h"
+#include "../../include/type_table.h"
+#include "../../include/cfg.h"
+#include "../../include/dataflow.h"
 
 /* --- SYMBOL TABLE OPERATIONS --- */
+#define SYMBOL_POOL_BLOCK 4096      // Bytes of the first pool block, later ones double
+
+__attribute__((cold, noinline))
+static void symbol_table_out_of_memory(void) {
+    printf("Memory allocation failed.\n");
+    exit(1);
+}
+
 // Initialize a new symbol table
 // Creates an empty symbol table structure with scope level set to 0
-SymbolTable* init_symbol_table() {
+SymbolTable* init_symbol_table(void) {
     SymbolTable* table = malloc(sizeof(SymbolTable));
     if (table) {
-        table->head = NULL;
+        table->slots = NULL;
+        table->slot_count = 0;
+        table->slot_used = 0;
+        table->symbols = NULL;
+        table->symbol_count = 0;
+        table->symbol_capacity = 0;
+        table->free_symbols = NULL;
+        arena_init(&table->pool, SYMBOL_POOL_BLOCK);
         table->current_scope = 0;
     }
     return table;
 }
 
+// Slot of name: the one holding it, or the empty one it would go in
+static SymbolSlot* find_slot(const SymbolTable* table, Atom name) {
+    size_t mask = table->slot_count - 1;
+    size_t slot = (name * 0x9E3779B97F4A7C15ull >> 32) & mask;
+    while (table->slots[slot].name != name && table->slots[slot].name != ATOM_NONE) slot = (slot + 1) & mask;
+    return &table->slots[slot];
+}
+
+// Double the slots, keeping every name seen so far
+static void grow_slots(SymbolTable* table) {
+    SymbolSlot* old = table->slots;
+    size_t old_count = table->slot_count;
+    table->slot_count = old_count ? old_count * 2 : 64;
+    table->slots = calloc(table->slot_count, sizeof(SymbolSlot));
+    if (!table->slots) symbol_table_out_of_memory();
+    for (size_t i = 0; i < old_count; i++) {
+        if (old[i].name != ATOM_NONE) *find_slot(table, old[i].name) = old[i];
+    }
+    free(old);
+}
+
 // Add a symbol to the table
-// Inserts a new variable with given name, type, and line number into the current scope
-void add_symbol(SymbolTable* table, const char* name, int type, int line) {
-    Symbol* symbol = malloc(sizeof(Symbol));
+// Inserts a new variable with given name and type into the current scope, returns it
+Symbol* add_symbol(SymbolTable* table, Atom name, int type) {
+    if ((table->slot_used + 1) * 2 > table->slot_count) grow_slots(table);
+    if (table->symbol_count == table->symbol_capacity) {
+        size_t capacity = table->symbol_capacity ? table->symbol_capacity * 2 : 64;
+        Symbol** symbols = realloc(table->symbols, capacity * sizeof(Symbol*));
+        if (!symbols) symbol_table_out_of_memory();
+        table->symbols = symbols;
+        table->symbol_capacity = capacity;
+    }
+    Symbol* symbol = table->free_symbols;
     if (symbol) {
-        strcpy(symbol->name, name);
-        symbol->type = type;
-        symbol->scope_level = table->current_scope;
-        symbol->line_declared = line;
-        symbol->is_initialized = 0;
-
-        // Add to beginning of list
-        symbol->next = table->head;
-        table->head = symbol;
-    }
+        table->free_symbols = symbol->next;
+    } else {
+        symbol = arena_alloc(&table->pool, sizeof(Symbol));
+        if (!symbol) symbol_table_out_of_memory();
+    }
+    symbol->name = name;
+    symbol->type = type;
+    symbol->scope_level = table->current_scope;
+    symbol->id = 0;
+
+    // Shadow whatever the name meant so far
+    SymbolSlot* slot = find_slot(table, name);
+    if (slot->name == ATOM_NONE) {
+        slot->name = name;
+        table->slot_used++;
+    }
+    symbol->next = slot->symbol;
+    slot->symbol = symbol;
+    table->symbols[table->symbol_count++] = symbol;
+    return symbol;
 }
 
 // Look up a symbol in the table by name across all accessible scopes
 // Returns the symbol if found, NULL otherwise
-Symbol* lookup_symbol(SymbolTable* table, const char* name) {
-    Symbol* current = table->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
+Symbol* lookup_symbol(SymbolTable* table, Atom name) {
+    if (table->slot_count == 0) return NULL;
+    return find_slot(table, name)->symbol;
 }
 
 // Look up a symbol in the table by name across current accessible scopes
 // Returns the symbol if found, NULL otherwise
-Symbol* lookup_symbol_current_scope(SymbolTable* table, const char* name) {
-    Symbol* current = table->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0 && current->scope_level == table->current_scope) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
-}
-
-// Prints the full symbol table
-void print_symbol_table(SymbolTable* table){
-    Symbol* current = table->head;
-    while (current) {
-        print_symbol(current);
-        current = current->next;
-    }
-}
-
-// Prints a specific symbol and its details
-void print_symbol(Symbol* symbol) {
-    printf("Type: %d Scope Level: %d Name: %s\n", symbol->type, symbol->scope_level, symbol->name);
+Symbol* lookup_symbol_current_scope(SymbolTable* table, Atom name) {
+    Symbol* symbol = lookup_symbol(table, name);
+    return symbol && symbol->scope_level == table->current_scope ? symbol : NULL;
 }
 
 // Increments the current scope level when entering a block (e.g., if, while)
@@ -88,363 +121,285 @@ void exit_scope(SymbolTable* table) {
 }
 
 // Remove symbols belonging to scope being exited
-// Cleans up symbols that are no longer accessible after leaving a scope
+// They are the newest ones, so only they are visited, and each name goes back to the symbol it shadowed
 void remove_symbols_in_current_scope(SymbolTable* table) {
-    Symbol* current = table->head;
-    Symbol* previous = NULL;
-    while (current) {
-        // when above scope level
-        if (current->scope_level > table->current_scope) {
-            if (current == table->head) {
-                table->head = current->next;
-                free_symbol(current);
-                current = table->head;
-            } else {
-                previous->next = current->next;
-                free_symbol(current);
-                current = previous->next;
-            }
-        } else { // otherwise move forward
-            previous = current;
-            current = current->next;
-        }
+    while (table->symbol_count > 0 && table->symbols[table->symbol_count - 1]->scope_level > table->current_scope) {
+        Symbol* symbol = table->symbols[--table->symbol_count];
+        find_slot(table, symbol->name)->symbol = symbol->next;
+        free_symbol(table, symbol);
     }
-
 }
 
-// Free twin symbol he aint deserve to be locked up for that (and his next in line)
-void free_symbol(Symbol* symbol) {
-    if(symbol->next!=NULL) {
-        free_symbol(symbol->next);
-    }
-    free(symbol);
+// Give a symbol back to the pool, it must no longer be in the table
+void free_symbol(SymbolTable* table, Symbol* symbol) {
+    symbol->next = table->free_symbols;
+    table->free_symbols = symbol;
 }
 
 // Free the symbol table memory
 // Releases all allocated memory when the symbol table is no longer needed
 void free_symbol_table(SymbolTable* table) {
+    free(table->slots);
+    free(table->symbols);
+    arena_free(&table->pool);
     free(table);
 }
 
+/* --- CHECKER STATE --- */
+// Put a declared symbol in scope, it is the newest one
+static void push_live(CheckerState* checker, SymbolId id) {
+    if (checker->live_count == checker->live_capacity) {
+        size_t capacity = checker->live_capacity ? checker->live_capacity * 2 : 64;
+        SymbolId* live = realloc(checker->live, capacity * sizeof(SymbolId));
+        if (!live) symbol_table_out_of_memory();
+        checker->live = live;
+        checker->live_capacity = capacity;
+    }
+    checker->live[checker->live_count++] = id;
+}
+
+// Prints the symbols in scope and their details, newest symbol first
+static void print_live_symbols(const CheckerState* checker) {
+    for (size_t i = checker->live_count; i > 0; i--) {
+        const SymbolInfo* symbol = &checker->resolution->symbols[checker->live[i - 1]];
+        printf("Type: %d Scope Level: %d Name: %s\n", symbol->type, (int)symbol->scope_level, atom_text(symbol->name));
+    }
+}
+
 /* --- SEMANTIC ANALYSIS FUNCTIONS --- */
 // Main semantic analysis function
-int analyze_semantics(ASTNode* ast) {
-    SymbolTable* table = init_symbol_table();
-    int result = check_program(ast, table);
-    free_symbol_table(table);
+// Names are resolved, expressions typed and definite initialization solved over the control-flow graph once
+// up front, the checks read the results and never look a name up. Errors go to diagnostics, whose log level
+// also decides whether the checks are traced.
+int analyze_semantics(const Ast* ast, NodeId root, DiagSink* diagnostics) {
+    Resolution resolution;
+    TypeTable types;
+    Cfg cfg;
+    InitAnalysis initialization;
+    if (!resolve_names(&resolution, ast, root)) {
+        printf("Memory allocation failed.\n");
+        return 0;
+    }
+    int typed = infer_types(&types, &resolution);
+    int built = typed && cfg_build(&cfg, ast, root);
+    int solved = built && analyze_initialization(&initialization, &cfg, &resolution, &types);
+    int result = 0;
+    if (solved) {
+        CheckerState checker = {ast, &resolution, &types, &initialization, NODE_NONE, diagnostics, NULL, 0, 0, 0};
+        result = check_program(root, &checker);
+        free(checker.live);
+    } else {
+        printf("Memory allocation failed.\n");
+    }
+    if (solved) init_analysis_free(&initialization);
+    if (built) cfg_free(&cfg);
+    if (typed) type_table_free(&types);
+    resolution_free(&resolution);
     return result;
 }
 
 // Check program node
-int check_program(ASTNode* node, SymbolTable* table) {
-    if (!node) return 1;
+int check_program(NodeId node, CheckerState* checker) {
+    if (node == NODE_NONE) return 1;
+    const Ast* ast = checker->ast;
     int result = 1;
-    if (node->type == AST_PROGRAM || node->type == AST_BLOCK) {
-        // Check left child (statement)
-        if (node->left) {
-            result = check_statement(node->left, table) && result;
-        }
-
-        // Check right child (rest of program)
-        if (node->right) {
-            result = check_program(node->right, table) && result;
+    if (ast_is_sequence(ast, node)) {
+        // Check every statement in order, a failed one does not stop the rest
+        for (uint32_t i = 0; i < ast_child_count(ast, node); i++) {
+            result = check_statement(ast_child(ast, node, i), checker) && result;
         }
     }
     return result;
 }
 
 // Check statements of all types, calls functions
-int check_statement(ASTNode* node, SymbolTable* table) {
-    if (node->type == AST_INT) {
-        printf("Checking statement of type: Variable Declaration Int\n");
-        return check_declaration(node, table);
-    }
-    if (node->type == AST_STRINGCHAR) {
-        printf("Checking statement of type: Variable Declaration String\\Char\n");
-        return check_declaration(node, table);
-    }
-    if (node->type == AST_ASSIGN) {
-        printf("Checking statement of type: Variable Assignment\n");
-        return check_assignment(node, table);
-    }
-    if (node->type == AST_BLOCK) {
-        printf("Checking statement of type: Block\n");
-        return check_block(node, table);
-    }
-    if (node->type == AST_PRINT) {
-        printf("Checking statement of type: Print\n");
-        return check_print(node, table);
-    }
-    if (node->type == AST_IF || node->type == AST_WHILE || node->type == AST_REPEAT) {
-        printf("Checking statement of type: If, While, or Repeat-Until\n");
-        return check_condition(node->left, table) && check_block(node->right, table);
-    }
-    if (node->type == AST_ELSE) {
-        printf("Checking statement of type: Else\n");
-        return check_block(node->right, table);
+int check_statement(NodeId node, CheckerState* checker) {
+    const Ast* ast = checker->ast;
+    ASTNodeType type = ast_kind(ast, node);
+    checker->statement = node;
+    if (type == AST_INT) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Variable Declaration Int\n");
+        return check_declaration(node, checker);
+    }
+    if (type == AST_STRINGCHAR) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Variable Declaration String\\Char\n");
+        return check_declaration(node, checker);
+    }
+    if (type == AST_ASSIGN) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Variable Assignment\n");
+        return check_assignment(node, checker);
+    }
+    if (type == AST_BLOCK) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Block\n");
+        return check_block(node, checker);
+    }
+    if (type == AST_PRINT) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Print\n");
+        return check_print(node, checker);
+    }
+    if (type == AST_IF || type == AST_WHILE || type == AST_REPEAT) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: If, While, or Repeat-Until\n");
+        return check_condition(ast_left(ast, node), checker) && check_block(ast_right(ast, node), checker);
+    }
+    if (type == AST_ELSE) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Else\n");
+        return check_block(ast_right(ast, node), checker);
+    }
+    if (type == AST_BREAK) {
+        DIAG_TRACE(checker->diagnostics, "Checking statement of type: Break\n");
+        return 1;
     }
-    printf("STATEMENT UNRECOGNIZED\n");
+    DIAG_TRACE(checker->diagnostics, "STATEMENT UNRECOGNIZED\n");
     return 0;
 }
 
 // Check a variable declaration
-int check_declaration(ASTNode* node, SymbolTable* table) {
-    const char* name = node->token.lexeme;
-
-    // Check if variable already declared in current scope
-    Symbol* existing = lookup_symbol_current_scope(table, name);
-    if (existing) {
-        semantic_error(SEM_ERROR_REDECLARED_VARIABLE, name, node->token.line);
+int check_declaration(NodeId node, CheckerState* checker) {
+    const Ast* ast = checker->ast;
+    Atom name = ast_atom(ast, node);
+    SourceLocation location = ast_location(ast, node);
+
+    // A name already declared in the same scope got no symbol from resolve_names
+    SymbolId id = node_symbol(checker->resolution, node);
+    if (id == SYMBOL_NONE) {
+        semantic_error(checker->diagnostics, SEM_ERROR_REDECLARED_VARIABLE, name, location);
         return 0;
     }
 
-    // Add to symbol table
-    add_symbol(table, name, node->type, node->token.line);
-    printf("Updated Symbol Table\n");
-    print_symbol_table(table);
+    // In scope until its block is left
+    push_live(checker, id);
+    if (diag_tracing(checker->diagnostics)) {
+        printf("Updated Symbol Table\n");
+        print_live_symbols(checker);
+    }
     return 1;
 }
 
 // Check a variable assignment
-int check_assignment(ASTNode* node, SymbolTable* table) {
-    const char* name = node->left->token.lexeme;
-
+int check_assignment(NodeId node, CheckerState* checker) {
+    const Ast* ast = checker->ast;
     // Check if variable exists
-    Symbol* symbol = lookup_symbol(table, name);
+    const SymbolInfo* symbol = node_symbol_info(checker->resolution, ast_left(ast, node));
     if (!symbol) {
-        semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, name, node->token.line);
+        semantic_error(checker->diagnostics, SEM_ERROR_UNDECLARED_VARIABLE, ast_atom(ast, ast_left(ast, node)), ast_location(ast, node));
         return 0;
     }
 
     // Check expression
     int expr_valid = 0;
     if(symbol->type == AST_STRINGCHAR){ // STRING CONDITIONS
-        expr_valid = check_string(node->right, table);
+        expr_valid = check_string(ast_right(ast, node), checker);
     }
     if(symbol->type == AST_INT){ // INT CONDITIONS
-        expr_valid = check_expression(node->right, table);
-    }
-
-    // Mark as initialized
-    if (expr_valid) {
-        symbol->is_initialized = 1;
+        expr_valid = check_expression(ast_right(ast, node), checker);
     }
     return expr_valid;
 }
 
-// Check an expression for type correctness
-bool check_expression(ASTNode* node, SymbolTable* table) {
-    // Recursive Until Bottom
-    bool left = true;
-    bool right = true;
-    bool current = false;
-    // go to left and right child
-    if(node->left != NULL) {
-        left = check_expression(node->left, table);
-    }
-    if (node->right != NULL) {
-        right = check_expression(node->right, table);
-    }
-
-    if (node->type == AST_NUMBER) {
-        //printf("Valid Number in expression\n");
-        current = true;
-    } else if (node->type == AST_IDENTIFIER) {
-        //printf("Caught Identifier, Checking Type\n");
-        const char* name = node->token.lexeme;
+// Where a name read by the statement being checked is reported. In a tree with shared nodes the token of a name
+// is only its first use, which may be in another statement or earlier in this one, so the statement is given
+static SourceLocation use_location(const CheckerState* checker, NodeId node) {
+    const Ast* ast = checker->ast;
+    return ast_location(ast, ast->shared ? checker->statement : node);
+}
 
+// Check an expression for type correctness
+// Valid when its cached type is int. The names in it are still visited, left operands before right ones, to
+// report the undeclared ones and the ones that may be uninitialized along some path to the statement. The
+// walk uses an explicit stack since an operator chain such as a + b + c nests as deep as it is long.
+bool check_expression(NodeId node, CheckerState* checker) {
+    const Ast* ast = checker->ast;
+    bool valid = node != NODE_NONE && node_type(checker->types, node) == TYPE_INT;
+    AstWalk walk;
+    ast_walk_begin(&walk, ast, node, 0);
+    while (ast_walk_next(&walk, &node, NULL)) {
+        if (ast_kind(ast, node) != AST_IDENTIFIER) continue;
         // Check if variable exists
-        Symbol* symbol = lookup_symbol(table, name);
+        const SymbolInfo* symbol = node_symbol_info(checker->resolution, node);
         if (!symbol) {
-            semantic_error(SEM_ERROR_UNDECLARED_VARIABLE, name, node->token.line);
-            return 0;
+            semantic_error(checker->diagnostics, SEM_ERROR_UNDECLARED_VARIABLE, ast_atom(ast, node), use_location(checker, node));
+        } else if(symbol->type == AST_INT && maybe_uninitialized(checker->initialization, checker->statement, node)) {
+            semantic_error(checker->diagnostics, SEM_ERROR_UNINITIALIZED_VARIABLE, ast_atom(ast, node), use_location(checker, node));
         }
-        if(symbol->type == AST_INT) {
-            //printf("Valid Identifier Type\n");
-            if(symbol->is_initialized != 1) {
-                semantic_error(SEM_ERROR_UNINITIALIZED_VARIABLE, name, node->token.line);
-            }
-            current = true;
-        } else {
-            //printf("Invalid Identifier Type\n");
-            current = false;
-        }
-    } else if (node->type == AST_BINOP || node->type == AST_UNARYOP || node->type == AST_FACTORIAL) {
-        //printf("Valid Operator in Sequence\n");
-        current = true;
-    }else {
-        //printf("Invalid Entry in expression\n");
-        current = false;
     }
-    return left && right && current;
+    if (walk.failed) {
+        printf("Memory allocation failed.\n");
+        valid = false;
+    }
+    ast_walk_end(&walk);
+    return valid;
 }
 
 // Check a string based expression for type correctness
-bool check_string(ASTNode* node, SymbolTable* table) {
-    if(node->type == AST_STRINGCHAR) {
-        printf("Valid String\\Char\n");
+bool check_string(NodeId node, CheckerState* checker) {
+    if(node != NODE_NONE && is_text_type(node_type(checker->types, node))) {
+        DIAG_TRACE(checker->diagnostics, "Valid String\\Char\n");
         return 1;
     }
     return 0;
 }
 
 // Check a block of statements, handling scope
-int check_block(ASTNode* node, SymbolTable* table) {
-    enter_scope(table);
-    printf("Block Parse Started\n");
-    int ret = check_program(node, table);
-    //print_symbol_table(table);
-    exit_scope(table);
-    printf("Block Parse Finished\n");
-    //print_symbol_table(table);
+int check_block(NodeId node, CheckerState* checker) {
+    checker->current_scope++;
+    DIAG_TRACE(checker->diagnostics, "Block Parse Started\n");
+    int ret = check_program(node, checker);
+    // The symbols declared in the block are the newest ones
+    checker->current_scope--;
+    const SymbolInfo* symbols = checker->resolution->symbols;
+    while (checker->live_count > 0 && symbols[checker->live[checker->live_count - 1]].scope_level > (uint32_t)checker->current_scope) {
+        checker->live_count--;
+    }
+    DIAG_TRACE(checker->diagnostics, "Block Parse Finished\n");
     return ret;
 }
 
 // Check print statement
-int check_print(ASTNode* node, SymbolTable* table) {
-    if (node->type != AST_PRINT || !node->left) {
+int check_print(NodeId node, CheckerState* checker) {
+    const Ast* ast = checker->ast;
+    NodeId value = ast_left(ast, node);
+    if (ast_kind(ast, node) != AST_PRINT || value == NODE_NONE) {
         return 0;
     }
     // checking for string/char print or int print
-    if(node->left->type == AST_STRINGCHAR) {
+    if(is_text_type(node_type(checker->types, value))) {
         // return the given string
-        printf("String/Char type print\n");
-        return check_string(node->left, table);
+        DIAG_TRACE(checker->diagnostics, "String/Char type print\n");
+        return check_string(value, checker);
     }
     // otherwise return the expression instead
-    printf("Identifier/Int type print\n");
-    return check_expression(node->left, table);
+    DIAG_TRACE(checker->diagnostics, "Identifier/Int type print\n");
+    return check_expression(value, checker);
 }
 
 // Check a condition (e.g., in if statements)
-int check_condition(ASTNode* node, SymbolTable* table) {
-    return check_expression(node, table);
+int check_condition(NodeId node, CheckerState* checker) {
+    return check_expression(node, checker);
 }
 
 /* --- ERROR REPORTING --- */
-void semantic_error(SemanticErrorType error, const char* name, int line) {
+// Report into diagnostics, a possibly uninitialized use is a warning since it depends on the path taken
+void semantic_error(DiagSink* diagnostics, SemanticErrorType error, Atom name, SourceLocation location) {
+    const char* format;
     switch (error) {
         case SEM_ERROR_UNDECLARED_VARIABLE:
-            printf("Undeclared variable '%s' on line '%d'\n", name, line);
+            format = "Undeclared variable '%s'";
             break;
         case SEM_ERROR_REDECLARED_VARIABLE:
-            printf("Variable '%s' already declared in this scope on line '%d'\n", name, line);
+            format = "Variable '%s' already declared in this scope";
             break;
         case SEM_ERROR_TYPE_MISMATCH:
-            printf("Type mismatch involving '%s' on line '%d'\n", name, line);
+            format = "Type mismatch involving '%s'";
             break;
         case SEM_ERROR_UNINITIALIZED_VARIABLE:
-            printf("Variable '%s' may be used uninitialized on line '%d'\n", name, line);
+            format = "Variable '%s' may be used uninitialized";
             break;
         case SEM_ERROR_INVALID_OPERATION:
-            printf("Invalid operation involving '%s' on line '%d'\n", name, line);
+            format = "Invalid operation involving '%s'";
             break;
         default:
-            printf("Unknown semantic error with '%s' on line '%d'\n", name, line);
+            format = "Unknown semantic error with '%s'";
     }
+    DiagSeverity severity = error == SEM_ERROR_UNINITIALIZED_VARIABLE ? DIAG_WARNING : DIAG_ERROR;
+    diag_report(diagnostics, severity, DIAG_SEMANTIC, error, location, format, atom_text(name));
 }
-
-int main() {
-    // get file
-    FILE *file = fopen("../phase2-w25/test/input_semantic_error.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
-
-    // get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    char *buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
-
-    // fill buffer with full file of chars in order
-    size_t bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    size_t b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
-        }
-    }
-    buffer[b] = '\0';
-
-    // Lexical analysis and parsing
-    printf("Parsing input:\n%s\n\n", buffer);
-    parser_init(buffer);
-    ASTNode *ast = parse();
-    printf("AST created. Printing...\n\n");
-    print_ast(ast, 0);
-
-    // Semantic analysis
-    int result = analyze_semantics(ast);
-    if (result) {
-        printf("Semantic analysis successful. No errors found.\n");
-    } else {
-        printf("Semantic analysis failed. Errors detected.\n");
-    }
-
-    // Free Vars
-    free_ast(ast);
-    free(buffer);
-    fclose(file);
-
-    // get file
-    file = fopen("../phase2-w25/test/input_valid.txt", "r");
-    if (file == NULL) {
-        printf("Error opening file\n");
-        return 1;
-    }
-
-    // get file size
-    fseek(file, 0, SEEK_END);
-    file_size = ftell(file);
-    rewind(file);
-
-    // get buffer size based on file size for chars
-    buffer = malloc(file_size + 1);
-    if (!buffer) {
-        printf("Memory allocation failed.\n");
-        fclose(file);
-        return 1;
-    }
-
-    // fill buffer with full file of chars in order
-    bytes_read = fread(buffer, 1, file_size, file);
-    buffer[bytes_read] = '\0';
-    b = 0;
-    for (size_t i = 0; i < bytes_read; i++) {
-        if (buffer[i] != '\r') {
-            buffer[b++] = buffer[i];
-        }
-    }
-    buffer[b] = '\0';
-
-    // Lexical analysis and parsing
-    printf("Parsing input:\n%s\n\n", buffer);
-    parser_init(buffer);
-    ast = parse();
-    printf("AST created. Printing...\n\n");
-    print_ast(ast, 0);
-
-    // Semantic analysis
-    result = analyze_semantics(ast);
-    if (result) {
-        printf("Semantic analysis successful. No errors found.\n");
-    } else {
-        printf("Semantic analysis failed. Errors detected.\n");
-    }
-
-    // Free Vars
-    free_ast(ast);
-    free(buffer);
-    fclose(file);
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,139 @@
+/* type_table.c */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../../include/tokens.h"
+#include "../../include/type_table.h"
+
+/* Nodes are typed in one scan of the node arrays. An expression that is not typed yet is finished with an
+ * explicit stack: a node stays on the stack until its operands are typed, so operator chains of any length
+ * are typed without recursion, and a node is never typed twice. */
+
+ValueType declared_type(const Ast* ast, NodeId declaration) {
+    if (ast_kind(ast, declaration) == AST_INT) return TYPE_INT;
+    // The keyword is the token before the name
+    TokenType keyword = (TokenType)ast->tokens->types[ast->token[declaration] - 1];
+    return keyword == TOKEN_CHAR ? TYPE_CHAR : TYPE_STRING;
+}
+
+const char* type_name(ValueType type) {
+    switch (type) {
+        case TYPE_INT: return "int";
+        case TYPE_CHAR: return "char";
+        case TYPE_STRING: return "string";
+        case TYPE_NULL: return "null";
+        case TYPE_ERROR: return "error";
+        default: return "none";
+    }
+}
+
+static int is_expression(const Ast* ast, NodeId node) {
+    switch (ast_kind(ast, node)) {
+        case AST_NUMBER:
+        case AST_IDENTIFIER:
+        case AST_NULL:
+        case AST_UNARYOP:
+        case AST_BINOP:
+        case AST_FACTORIAL:
+        case AST_ERROR:
+            return 1;
+        case AST_STRINGCHAR:
+            return ast_token_type(ast, node) != TOKEN_IDENTIFIER; // Literal, not a declaration
+        default:
+            return 0;
+    }
+}
+
+// Type of an operand, a missing one is an error
+static ValueType operand_type(const TypeTable* table, NodeId node) {
+    return node == NODE_NONE ? TYPE_ERROR : node_type(table, node);
+}
+
+// Type of a node whose operands are typed
+static ValueType type_of(const TypeTable* table, const Resolution* resolution, NodeId node) {
+    const Ast* ast = resolution->ast;
+    switch (ast_kind(ast, node)) {
+        case AST_NUMBER:
+            return TYPE_INT;
+        case AST_IDENTIFIER: {
+            const SymbolInfo* symbol = node_symbol_info(resolution, node);
+            return symbol ? declared_type(ast, symbol->declaration) : TYPE_ERROR;
+        }
+        case AST_STRINGCHAR: {
+            TokenType token = ast_token_type(ast, node);
+            return token == TOKEN_CHAR_LITERAL || token == TOKEN_CHAR ? TYPE_CHAR : TYPE_STRING;
+        }
+        case AST_NULL:
+            return TYPE_NULL;
+        case AST_UNARYOP:
+        case AST_FACTORIAL:
+            return operand_type(table, ast_left(ast, node)) == TYPE_INT ? TYPE_INT : TYPE_ERROR;
+        case AST_BINOP:
+            return operand_type(table, ast_left(ast, node)) == TYPE_INT
+                   && operand_type(table, ast_right(ast, node)) == TYPE_INT ? TYPE_INT : TYPE_ERROR;
+        default:
+            return TYPE_ERROR;
+    }
+}
+
+// Operand of node that still needs a type, NODE_NONE when both are done
+static NodeId untyped_operand(const TypeTable* table, const Ast* ast, NodeId node) {
+    ASTNodeType kind = ast_kind(ast, node);
+    if (kind != AST_UNARYOP && kind != AST_FACTORIAL && kind != AST_BINOP) return NODE_NONE;
+    NodeId left = ast_left(ast, node);
+    if (left != NODE_NONE && node_type(table, left) == TYPE_NONE) return left;
+    NodeId right = kind == AST_BINOP ? ast_right(ast, node) : NODE_NONE;
+    if (right != NODE_NONE && node_type(table, right) == TYPE_NONE) return right;
+    return NODE_NONE;
+}
+
+typedef struct {
+    NodeId* nodes;
+    size_t count;
+    size_t capacity;
+} TypeStack;
+
+static int push(TypeStack* stack, NodeId node) {
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity ? stack->capacity * 2 : 64;
+        NodeId* nodes = realloc(stack->nodes, capacity * sizeof(NodeId));
+        if (!nodes) return 0;
+        stack->nodes = nodes;
+        stack->capacity = capacity;
+    }
+    stack->nodes[stack->count++] = node;
+    return 1;
+}
+
+int infer_types(TypeTable* table, const Resolution* resolution) {
+    const Ast* ast = resolution->ast;
+    table->count = ast->count;
+    table->types = calloc(ast->count ? ast->count : 1, sizeof(uint8_t)); // TYPE_NONE everywhere
+    if (!table->types) return 0;
+
+    TypeStack stack = {NULL, 0, 0};
+    int ok = 1;
+    for (NodeId root = 1; ok && root < ast->count; root++) {
+        if (node_type(table, root) != TYPE_NONE || !is_expression(ast, root)) continue;
+        ok = push(&stack, root);
+        while (ok && stack.count > 0) {
+            NodeId node = stack.nodes[stack.count - 1];
+            NodeId operand = untyped_operand(table, ast, node);
+            if (operand != NODE_NONE) {
+                ok = push(&stack, operand);
+                continue;
+            }
+            table->types[node] = (uint8_t)type_of(table, resolution, node);
+            stack.count--;
+        }
+    }
+    free(stack.nodes);
+    if (!ok) type_table_free(table);
+    return ok;
+}
+
+void type_table_free(TypeTable* table) {
+    free(table->types);
+    table->types = NULL;
+    table->count = 0;
+}
@@ -0,0 +1,243 @@
+/* source.c */
+// madvise and MADV_SEQUENTIAL are not part of ISO C, ask for them under -std=c11 too
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../../include/source.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SOURCE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read the whole file into an allocated, NUL-terminated buffer
+static int source_read(Source* source, FILE* file) {
+    // get file size
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    if (file_size < 0) {
+        return 0;
+    }
+
+    // get buffer size based on file size for chars
+    char* buffer = malloc(file_size + 1);
+    if (!buffer) {
+        printf("Memory allocation failed.\n");
+        return 0;
+    }
+
+    // fill buffer with full file of chars in order
+    size_t bytes_read = fread(buffer, 1, file_size, file);
+    buffer[bytes_read] = '\0';
+    source->data = buffer;
+    source->length = bytes_read;
+    source->mapped = 0;
+    source->lines = NULL;
+    return 1;
+}
+
+int source_load(Source* source, const char* path) {
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = 0;
+    source->lines = NULL;
+
+#ifdef SOURCE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error opening file\n");
+        return 0;
+    }
+    struct stat info;
+    long page = sysconf(_SC_PAGESIZE);
+    // The bytes after the end of file in the last mapped page read as zero, which gives the
+    // terminator for free. Files that fill their last page exactly have no room for it and are read.
+    if (fstat(fd, &info) == 0 && info.st_size > 0 && page > 0 && info.st_size % page != 0) {
+        void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, info.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            source->data = map;
+            source->length = info.st_size;
+            source->mapped = 1;
+            source->lines = NULL;
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Error opening file\n");
+        return 0;
+    }
+    int ok = source_read(source, file);
+    fclose(file);
+    return ok;
+}
+
+int source_from_string(Source* source, const char* text, size_t length) {
+    char* buffer = malloc(length + 1);
+    if (!buffer) {
+        printf("Memory allocation failed.\n");
+        return 0;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    source->data = buffer;
+    source->length = length;
+    source->mapped = 0;
+    source->lines = NULL;
+    return 1;
+}
+
+int source_edit(Source* source, size_t offset, size_t removed, const char* text, size_t length) {
+    if (offset > source->length || removed > source->length - offset) return 0;
+    size_t tail = source->length - offset - removed;
+    size_t new_length = offset + length + tail;
+    char* data;
+    if (source->mapped || new_length > source->length) {
+        data = source->mapped ? malloc(new_length + 1) : realloc((char*)source->data, new_length + 1);
+        if (!data) {
+            printf("Memory allocation failed.\n");
+            return 0;
+        }
+    } else {
+        data = (char*)source->data;
+    }
+    if (source->mapped) {
+        memcpy(data, source->data, offset);
+        memcpy(data + offset + length, source->data + offset + removed, tail);
+#ifdef SOURCE_MMAP
+        munmap((void*)source->data, source->length);
+#endif
+        source->mapped = 0;
+    } else {
+        memmove(data + offset + length, data + offset + removed, tail);
+    }
+    memcpy(data + offset, text, length);
+    data[new_length] = '\0';
+    source->data = data;
+    source->length = new_length;
+    free(source->lines);
+    source->lines = NULL;
+    return 1;
+}
+
+// 8 bytes a step with a multiply and fold, so a change to the bytes or the length almost always changes the hash
+// Four lanes take every fourth word, so their multiplies overlap instead of waiting on each other
+uint64_t source_hash(const Source* source) {
+    const char* data = source->data;
+    size_t length = source->length;
+    uint64_t lanes[4] = {0x9E3779B97F4A7C15ull ^ length, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                         0x27D4EB2F165667C5ull};
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * 0xFF51AFD7ED558CCDull;
+            lanes[lane] ^= lanes[lane] >> 32;
+        }
+    }
+    // The lanes and the last words go through one chain in order
+    uint64_t hash = lanes[0];
+    for (int lane = 1; lane < 4; lane++) {
+        hash = (hash ^ lanes[lane]) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, length - i);
+    hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    return hash ^ (hash >> 29);
+}
+
+/* --- LINE INDEX --- */
+struct SourceLines {
+    size_t count;
+    uint32_t starts[];      // Offset of the first byte of every line, starts[0] is 0
+};
+
+// Collect the line starts with memchr, which the C library vectorizes
+static struct SourceLines* source_lines_build(const Source* source) {
+    size_t capacity = source->length / 32 + 16;
+    struct SourceLines* lines = malloc(sizeof(struct SourceLines) + capacity * sizeof(uint32_t));
+    if (!lines) return NULL;
+    lines->count = 1;
+    lines->starts[0] = 0;
+    const char* end = source->data + source->length;
+    for (const char* p = source->data; (p = memchr(p, '\n', end - p)) != NULL; ) {
+        p++;
+        if (lines->count == capacity) {
+            capacity *= 2;
+            struct SourceLines* grown = realloc(lines, sizeof(struct SourceLines) + capacity * sizeof(uint32_t));
+            if (!grown) {
+                free(lines);
+                return NULL;
+            }
+            lines = grown;
+        }
+        lines->starts[lines->count++] = (uint32_t)(p - source->data);
+    }
+    return lines;
+}
+
+SourceLocation source_location(const Source* source, size_t offset) {
+    SourceLocation location = {0, 0};
+    struct SourceLines* lines = __atomic_load_n(&source->lines, __ATOMIC_ACQUIRE);
+    if (!lines) {
+        // Threads racing to build the index each build one, the first to publish it wins
+        struct SourceLines* built = source_lines_build(source);
+        if (!built) return location;
+        struct SourceLines* expected = NULL;
+        if (__atomic_compare_exchange_n(&((Source*)source)->lines, &expected, built, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            lines = built;
+        } else {
+            free(built);
+            lines = expected;
+        }
+    }
+
+    // Last line starting at or before offset
+    size_t low = 0, high = lines->count - 1;
+    while (low < high) {
+        size_t mid = low + (high - low + 1) / 2;
+        if (lines->starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    location.line = (int)low + 1;
+    location.column = (int)(offset - lines->starts[low]) + 1;
+    return location;
+}
+
+void source_free(Source* source) {
+    free(source->lines);
+    source->lines = NULL;
+    if (!source->data) return;
+#ifdef SOURCE_MMAP
+    if (source->mapped) {
+        munmap((void*)source->data, source->length);
+        source->data = NULL;
+        return;
+    }
+#endif
+    free((void*)source->data);
+    source->data = NULL;
+}